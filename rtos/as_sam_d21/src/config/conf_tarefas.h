@@ -0,0 +1,22 @@
+/*
+ * conf_tarefas.h
+ *
+ * Tabela estatica de tarefas, usada quando cfg_TABELA_ESTATICA_TAREFAS = 1
+ * (rtos.h). As pilhas, os TCBs e o numero de tarefas sao definidos em tempo
+ * de compilacao a partir desta tabela; nao se chama CriaTarefa.
+ */ 
+
+
+#ifndef CONF_TAREFAS_H_
+#define CONF_TAREFAS_H_
+
+/* X(funcao, nome, tamanho da pilha em palavras, prioridade)
+   A tarefa ociosa eh acrescentada pelo sistema com prioridade 0 */
+#define TABELA_TAREFAS(X) \
+	X(tarefa_periodica,     "Tarefa Periodica", (TAM_MINIMO_PILHA + 24), 4) \
+	X(tarefa_cpu_intensiva, "Tarefa Intensiva", (TAM_MINIMO_PILHA + 24), 1)
+
+/* tamanho da pilha da tarefa ociosa, em palavras */
+#define TAM_PILHA_OCIOSA_TABELA		(TAM_MINIMO_PILHA + 24)
+
+#endif /* CONF_TAREFAS_H_ */
@@ -8,14 +8,15 @@
 #include "cpu-port.h"
 #include "rtos.h"
 
-stackptr_t CriaContexto(tarefa_t endereco_tarefa, stackptr_t ptr_pilha)
+/* ptr_pilha aponta para o fim da pilha, de tamanho palavras, que este 
+   processador nao precisa conhecer */
+stackptr_t CriaContexto(tarefa_t endereco_tarefa, stackptr_t ptr_pilha, uint16_t tamanho)
 {
-	#define INITIAL_XPSR		0x01000000
-	
 	uint32_t reg_val;
+	(void)tamanho;
 	*(--ptr_pilha) = INITIAL_XPSR;     /* xPSR */
 	*(--ptr_pilha) = (uint32_t)endereco_tarefa;  /* R15 */
-	*(--ptr_pilha) = 0x00;				   /* R14 */
+	*(--ptr_pilha) = (uint32_t)FimDeTarefa;	   /* R14: retorno da funcao da tarefa */
 	
 	*(--ptr_pilha) = 0x12;			   /* R12 */
 	
@@ -41,19 +42,115 @@ stackptr_t CriaContexto(tarefa_t endereco_tarefa, stackptr_t ptr_pilha)
 	
 }
 
+/* numero de ciclos de clock de uma marca de tempo */
+static uint32_t ciclos_por_marca;
+
+#if (cfg_CPU_CLOCK_HZ / cfg_MARCA_TEMPO_HZ) > 0x01000000UL
+#error "a marca de tempo nao cabe no SysTick (24 bits): aumente cfg_MARCA_TEMPO_HZ"
+#endif
+
 /* Codigo dependente de hardware usado para 
- * configuracao da marca de tempo do sistema multitarefas */
+ * configuracao da marca de tempo do sistema multitarefas. O SysTick conta 
+ * o clock da CPU, que deve ser cfg_CPU_CLOCK_HZ (48 MHz no SAMD21, 16 MHz no
+ * nRF51 do micro:bit) */
 void ConfiguraMarcaTempo(void)
 {   
-	
-	    uint32_t cpu_clock_hz = 48000000UL; //system_cpu_clock_get_hz();
-		uint16_t valor_comparador = cpu_clock_hz/cfg_MARCA_TEMPO_HZ; //(cfg_CPU_CLOCK_HZ / cfg_MARCA_TEMPO_HZ);
+		uint32_t valor_comparador = cfg_CPU_CLOCK_HZ / cfg_MARCA_TEMPO_HZ;
+		
+		ciclos_por_marca = valor_comparador;
 		
 		*(NVIC_SYSTICK_CTRL) = 0;						// Desabilita SysTick Timer
 		*(NVIC_SYSTICK_LOAD) = valor_comparador - 1;	// Configura a contagem
 		*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT | NVIC_SYSTICK_ENABLE;  // Inicia
 }
 
+#if cfg_MODO_SEM_MARCA_TEMPO
+/* Codigo dependente de hardware usado no modo sem marca de tempo: reprograma o 
+ * SysTick para interromper somente daqui a qtas_marcas marcas de tempo e coloca 
+ * o processador para dormir (WFI) ate a proxima interrupcao. Deve ser chamada com
+ * as interrupcoes desabilitadas. Retorna o numero de marcas de tempo completas que
+ * passaram, sem contar aquela cuja interrupcao do SysTick ficou pendente. 
+ * O erro acumulado se limita aos poucos ciclos em que o SysTick fica parado 
+ * em cada reprogramacao */
+tick_t DormeMarcasDeTempo(tick_t qtas_marcas)
+{
+	uint32_t marcas_maximas = 0x00FFFFFFUL / ciclos_por_marca;	/* SysTick tem 24 bits */
+	uint32_t recarga, restante, decorrido, proximo_periodo;
+	tick_t completas;
+	
+	if(qtas_marcas > marcas_maximas)
+	{
+		qtas_marcas = (tick_t)marcas_maximas;
+	}
+	
+	/* para o SysTick; o que falta da marca de tempo atual entra na conta */
+	*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT;
+	restante = *(NVIC_SYSTICK_VAL);
+	
+	if((*(NVIC_INT_CTRL_B) & NVIC_PENDSTSET) || restante == 0)
+	{
+		/* uma marca de tempo ja esta pendente: nao dorme */
+		*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT | NVIC_SYSTICK_ENABLE;
+		return 0;
+	}
+	
+	/* interrompe na fronteira da ultima marca de tempo */
+	recarga = restante + (uint32_t)(qtas_marcas - 1) * ciclos_por_marca;
+	if(recarga <= 1)
+	{
+		/* a marca de tempo termina no proximo ciclo e LOAD = 0 pararia o 
+		   SysTick: nao dorme */
+		*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT | NVIC_SYSTICK_ENABLE;
+		return 0;
+	}
+	*(NVIC_SYSTICK_LOAD) = recarga - 1;
+	*(NVIC_SYSTICK_VAL) = 0;
+	*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT | NVIC_SYSTICK_ENABLE;
+	
+	DORME_ATE_INTERRUPCAO();
+	
+	/* acordou: para o SysTick para medir o tempo que passou */
+	*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT;
+	restante = *(NVIC_SYSTICK_VAL);
+	
+	if(*(NVIC_INT_CTRL_B) & NVIC_PENDSTSET)
+	{
+		/* o SysTick expirou: a ultima marca sera contada pela interrupcao 
+		   pendente e o que passou depois dela eh descontado do proximo periodo */
+		completas = qtas_marcas - 1;
+		decorrido = (recarga - 1) - restante;
+		proximo_periodo = (decorrido < ciclos_por_marca) ? (ciclos_por_marca - decorrido) : ciclos_por_marca;
+	}else
+	{
+		/* acordou antes por outra interrupcao: conta as fronteiras de marca 
+		   de tempo ja ultrapassadas */
+		completas = qtas_marcas - (tick_t)((restante / ciclos_por_marca) + ((restante % ciclos_por_marca) != 0));
+		proximo_periodo = restante % ciclos_por_marca;
+		if(proximo_periodo == 0)
+		{
+			proximo_periodo = ciclos_por_marca;
+		}
+	}
+	
+	/* a fronteira seguinte esta a um ciclo: ja conta como ultrapassada, pois 
+	   LOAD = 0 pararia o SysTick */
+	if(proximo_periodo <= 1)
+	{
+		completas++;
+		proximo_periodo = ciclos_por_marca;
+	}
+	
+	/* reinicia o SysTick com o restante da marca atual e volta a recarga normal,
+	   que passa a valer a partir da proxima interrupcao */
+	*(NVIC_SYSTICK_LOAD) = proximo_periodo - 1;
+	*(NVIC_SYSTICK_VAL) = 0;
+	*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT | NVIC_SYSTICK_ENABLE;
+	*(NVIC_SYSTICK_LOAD) = ciclos_por_marca - 1;
+	
+	return completas;
+}
+#endif
+
 /* rotinas de interrupcao necessarias */
 __attribute__ ((naked)) void SVC_Handler(void)
 {
@@ -82,13 +179,66 @@ __attribute__ ((naked)) void PendSV_Handler(void)
 	
 }
 
+#if cfg_MEDE_MARCA_TEMPO
+/* duracao em ciclos de clock da ultima e da maior execucao da marca de tempo, 
+   medida pelo proprio contador do SysTick, que e decrescente */
+volatile uint32_t ciclos_marca_tempo = 0;
+volatile uint32_t ciclos_marca_tempo_max = 0;
+#endif
+
+#if cfg_PERFIL > 0
+/* com o perfil, o SysTick entra por ENTRADA_PERFIL, que le o PC interrompido
+   antes que o prologo de MarcaDeTempo empilhe algo na MSP, e segue para ela.
+   Para amostrar mais rapido e sem o sincronismo com as tarefas periodicas, um
+   temporizador dedicado de menor prioridade pode entrar da mesma forma e 
+   chamar PerfilRegistra */
+__attribute__ ((naked)) void SysTick_Handler(void)
+{
+	ENTRADA_PERFIL(MarcaDeTempo);
+}
+#endif
+
 /* Codigo dependente de hardware usado para 
    realizar a marca de tempo do sistema multitarefas - interrupcao */
+#if cfg_PERFIL > 0
+void MarcaDeTempo(uint32_t pc)
+#else
 void SysTick_Handler(void)
+#endif
 {	
+#if cfg_MEDE_MARCA_TEMPO
+	 uint32_t inicio = *(NVIC_SYSTICK_VAL);
+#endif
+
+#if cfg_PERFIL > 0
+	 PerfilRegistra(pc);
+#endif
+	 
+	 /* as interrupcoes de perifericos tem prioridade maior que o SysTick e
+	    tambem podem chamar o nucleo (SemaforoLibera, EventosSinaliza, ...):
+	    a marca de tempo altera as listas com as interrupcoes desabilitadas */
+	 REG_ATOMICA_INICIO();
 	 
+#if cfg_MODO_PREEMPTIVO
+	 /* no modo preemptivo, so troca de contexto se uma tarefa de maior 
+	    prioridade que a atual ficou pronta nesta marca de tempo */
+	 if(ExecutaMarcaDeTempo() && modo_preemptivo)
+	 {
+		 TrocaContexto();
+	 }
+#else
 	 ExecutaMarcaDeTempo();    
-	 //TrocaContexto();   /* para o uso como sistema preemptivo */
+#endif
+
+	 REG_ATOMICA_FIM();
+	 
+#if cfg_MEDE_MARCA_TEMPO
+	 ciclos_marca_tempo = inicio - *(NVIC_SYSTICK_VAL);
+	 if(ciclos_marca_tempo > ciclos_marca_tempo_max)
+	 {
+		 ciclos_marca_tempo_max = ciclos_marca_tempo;
+	 }
+#endif
 }
 
 void HardFault_Handler(void)
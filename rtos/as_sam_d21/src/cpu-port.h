@@ -17,15 +17,32 @@
 /* tipo do ponteiro de pilha */
 typedef uint32_t* stackptr_t;
 
+/* contexto inicial de uma tarefa: 16 palavras, de R8 (posicao 0) ate xPSR 
+   (posicao 15), na ordem em que RESTAURA_CONTEXTO e o retorno da excecao os
+   retiram da pilha. So o xPSR (bit Thumb), o PC e o LR precisam de valor 
+   inicial; ptr_pilha aponta para a posicao 0. O tamanho da pilha nao eh usado */
+#define TAM_CONTEXTO		16
+#define INITIAL_XPSR		0x01000000
+#define CONTEXTO_INICIAL(ptr_pilha, endereco_tarefa, tamanho)	\
+	do{															\
+		(void)(tamanho);										\
+		(ptr_pilha)[15] = INITIAL_XPSR;	/* xPSR */				\
+		(ptr_pilha)[14] = (uint32_t)(endereco_tarefa); /* R15 */	\
+		(ptr_pilha)[13] = (uint32_t)FimDeTarefa; /* R14 */	\
+	}while(0)
+
 
 /* registradores da cpu ARM Cortex-M*/
 #define NVIC_INT_CTRL_B         ( ( volatile unsigned long *) 0xe000ed04 )
 #define NVIC_SYSPRI3			( ( volatile unsigned long *) 0xe000ed20 )
 #define NVIC_SYSTICK_CTRL       ( ( volatile unsigned long *) 0xe000e010 )
 #define NVIC_SYSTICK_LOAD       ( ( volatile unsigned long *) 0xe000e014 )
+#define NVIC_SYSTICK_VAL        ( ( volatile unsigned long *) 0xe000e018 )
 
 #define NVIC_PENDSVSET      			0x10000000         			// Dispara excecao PendSV
 #define NVIC_PENDSVCLR      			0x08000000         			// Limpa a flag PendSV
+#define NVIC_PENDSTSET      			0x04000000         			// Interrupcao do SysTick pendente
+#define NVIC_SYSTICK_COUNTFLAG  		0x00010000
 #define NVIC_SYSTICK_CLK        		0x00000004
 #define NVIC_SYSTICK_INT        		0x00000002
 #define NVIC_SYSTICK_ENABLE     		0x00000001
@@ -44,6 +61,21 @@ typedef uint32_t* stackptr_t;
 #define TrocaContexto()		    TROCA_CONTEXTO()
 #define Clear_PendSV(void)		*(NVIC_INT_CTRL_B) = NVIC_PENDSVCLR
 
+/* contador de ciclos de clock para a medicao do tempo de execucao das tarefas:
+   o SysTick conta para baixo de LOAD ate 0 a cada marca de tempo. Se a 
+   interrupcao do SysTick esta pendente, o contador ja voltou a LOAD mas a marca
+   de tempo ainda nao foi contada */
+#define CICLOS_POR_MARCA()		(*(NVIC_SYSTICK_LOAD) + 1)
+#define CICLOS_DESDE_MARCA()	(*(NVIC_SYSTICK_LOAD) - *(NVIC_SYSTICK_VAL))
+#define MARCA_TEMPO_PENDENTE()	(*(NVIC_INT_CTRL_B) & NVIC_PENDSTSET)
+
+#define DORME_ATE_INTERRUPCAO()	__asm volatile(" DSB \n WFI \n ISB");
+
+/* impede o compilador de reordenar acessos a memoria atraves deste ponto. Com um
+   so nucleo, as interrupcoes veem os acessos na ordem do programa, entao nao
+   eh preciso instrucao de barreira (DMB) */
+#define BARREIRA_MEMORIA()		__asm volatile("" ::: "memory");
+
 #define GERA_INTERRUPCAO_SW()      __asm(  /* Call SVC to start the first task. */		\
 										"cpsie i				\n"					\
 										"svc 0					\n"					\
@@ -88,7 +120,33 @@ typedef uint32_t* stackptr_t;
 									"BX      R1               	\n"						  \
 								)
 
-#define SALVA_ISR()			// em branco para este processador
+/* o PendSV tem a menor prioridade: sem isto uma interrupcao de periferico que
+   chama o nucleo poderia alterar as listas durante TrocaContextoDasTarefas.
+   RESTAURA_CONTEXTO reabilita as interrupcoes */
+#define SALVA_ISR()			__asm volatile(" CPSID I");
+
+/* entrada de uma interrupcao de amostragem do perfil, no inicio de um 
+   tratador naked, antes de qualquer empilhamento: o bit 2 do LR (EXC_RETURN)
+   diz se a entrada na interrupcao empilhou o contexto na PSP (tarefa) ou na 
+   MSP (outra interrupcao, ou main antes da primeira tarefa). O PC 
+   interrompido esta na posicao 6 (R0-R3, R12, LR, PC, xPSR) e segue em R0
+   para funcao(uint32_t pc), que retorna da interrupcao pelo LR intacto. A
+   mascara vem de LDR =, aceito tanto na sintaxe dividida (a das outras
+   macros) quanto na unificada */
+#define ENTRADA_PERFIL(funcao)	__asm volatile(						\
+								"LDR     R0, =4			\n"		\
+								"MOV     R1, LR			\n"		\
+								"TST     R0, R1			\n"		\
+								"BEQ     1f				\n"		\
+								"MRS     R0, PSP		\n"		\
+								"B       2f				\n"		\
+								"1:						\n"		\
+								"MRS     R0, MSP		\n"		\
+								"2:						\n"		\
+								"LDR     R0, [R0, #24]	\n"		\
+								"LDR     R1, =" #funcao "	\n"		\
+								"BX      R1				\n"		\
+							)
 
 #define RESTAURA_ISR()		__asm(							  \
 								"LDR     R1,=0xFFFFFFFD     \n"						  \
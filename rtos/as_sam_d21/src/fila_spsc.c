@@ -0,0 +1,84 @@
+/*
+ * fila_spsc.c
+ *
+ */ 
+
+#include "fila_spsc.h"
+#include <string.h>
+
+/* numero de bytes na fila: para o consumidor, nunca maior que o real; para o
+   produtor, nunca menor */
+uint32_t FilaSPSCQuantidade(const fila_spsc_t* fila)
+{
+	return fila->escrita - fila->leitura;
+}
+
+/* chamada somente pelo produtor: escreve ate n bytes, quantos couberem, e 
+   retorna quantos foram escritos */
+uint32_t FilaSPSCEscreve(fila_spsc_t* fila, const uint8_t* dados, uint32_t n)
+{
+	uint32_t escrita = fila->escrita;
+	uint32_t antes = escrita - fila->leitura;
+	uint32_t posicao = escrita & fila->mascara;
+	uint32_t parte;
+	
+	if(n > fila->mascara + 1 - antes)
+	{
+		n = fila->mascara + 1 - antes;		/* somente o espaco livre */
+	}
+	
+	/* copia em ate dois trechos, ate o fim da area e a partir do inicio */
+	parte = fila->mascara + 1 - posicao;
+	if(parte > n)
+	{
+		parte = n;
+	}
+	memcpy(&fila->area[posicao], dados, parte);
+	memcpy(fila->area, dados + parte, n - parte);
+	
+	/* os dados devem estar na area antes do consumidor ver o novo indice */
+	BARREIRA_MEMORIA();
+	fila->escrita = escrita + n;
+	
+	/* acorda o consumidor somente quando a quantidade cruza o limiar */
+	if(fila->sinal != NULL && antes < fila->limiar && antes + n >= fila->limiar)
+	{
+		SemaforoLibera(fila->sinal);
+	}
+	
+	return n;
+}
+
+/* chamada somente pelo consumidor: le ate n bytes, quantos houver, e retorna
+   quantos foram lidos. Antes de esperar pelo sinal de novo, o consumidor deve 
+   esvaziar a fila (ler ate retornar menos que n), senao o limiar ja atingido 
+   nao eh cruzado outra vez */
+uint32_t FilaSPSCLe(fila_spsc_t* fila, uint8_t* dados, uint32_t n)
+{
+	uint32_t leitura = fila->leitura;
+	uint32_t quantidade = fila->escrita - leitura;
+	uint32_t posicao = leitura & fila->mascara;
+	uint32_t parte;
+	
+	if(n > quantidade)
+	{
+		n = quantidade;
+	}
+	
+	/* os indices sao lidos antes dos dados */
+	BARREIRA_MEMORIA();
+	
+	parte = fila->mascara + 1 - posicao;
+	if(parte > n)
+	{
+		parte = n;
+	}
+	memcpy(dados, &fila->area[posicao], parte);
+	memcpy(dados + parte, fila->area, n - parte);
+	
+	/* os dados devem ser copiados antes do produtor reutilizar o espaco */
+	BARREIRA_MEMORIA();
+	fila->leitura = leitura + n;
+	
+	return n;
+}
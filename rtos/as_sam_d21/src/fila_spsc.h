@@ -0,0 +1,47 @@
+/*
+ * fila_spsc.h
+ *
+ */ 
+
+
+#ifndef FILA_SPSC_H_
+#define FILA_SPSC_H_
+
+#include "rtos.h"
+
+/**
+* \struct fila_spsc_t
+* Fila circular de bytes para um unico produtor e um unico consumidor, por 
+* exemplo uma interrupcao da UART e uma tarefa. Cada indice eh alterado somente
+* por um dos lados, por isso a fila nao precisa de regiao atomica. Os indices 
+* contam o total de bytes escritos e lidos e dao a volta naturalmente; a 
+* capacidade deve ser potencia de 2.
+* Opcionalmente, quando a quantidade de bytes na fila atinge o limiar, o 
+* produtor libera o semaforo sinal, acordando o consumidor uma vez por lote.
+*/
+
+typedef struct
+{
+	uint8_t				*area;       ///< Area de armazenamento com capacidade bytes
+	uint32_t			mascara;     ///< Capacidade - 1
+	volatile uint32_t	escrita;     ///< Total de bytes escritos, alterado somente pelo produtor
+	volatile uint32_t	leitura;     ///< Total de bytes lidos, alterado somente pelo consumidor
+	semaforo_t			*sinal;      ///< Semaforo liberado ao atingir o limiar (NULL = nenhum)
+	uint32_t			limiar;      ///< Quantidade de bytes que acorda o consumidor
+} fila_spsc_t;
+
+/* inicializador de uma fila com a area dada; capacidade deve ser potencia de 2,
+   pois os indices sao reduzidos a area pela mascara: outro valor nao compila 
+   (tamanho negativo no sizeof) */
+#define FILA_SPSC_INICIALIZADOR(area, capacidade, sinal, limiar) \
+	{(uint8_t *)(area), (capacidade) - 1 + 0 * sizeof(char[FILA_SPSC_POTENCIA_DE_2(capacidade) ? 1 : -1]), \
+	0, 0, (sinal), (limiar)}
+
+#define FILA_SPSC_POTENCIA_DE_2(capacidade)	\
+	((capacidade) > 0 && ((capacidade) & ((capacidade) - 1)) == 0)
+
+uint32_t FilaSPSCQuantidade(const fila_spsc_t* fila);
+uint32_t FilaSPSCEscreve(fila_spsc_t* fila, const uint8_t* dados, uint32_t n);
+uint32_t FilaSPSCLe(fila_spsc_t* fila, uint8_t* dados, uint32_t n);
+
+#endif /* FILA_SPSC_H_ */
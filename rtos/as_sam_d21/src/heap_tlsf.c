@@ -0,0 +1,307 @@
+/*
+ * heap_tlsf.c
+ *
+ */
+
+#include "heap_tlsf.h"
+
+/* indicadores guardados nos bits menos significativos do tamanho */
+#define BLOCO_LIVRE				((size_t)1)
+#define BLOCO_ANTERIOR_LIVRE	((size_t)2)
+#define BLOCO_INDICADORES		(BLOCO_LIVRE | BLOCO_ANTERIOR_LIVRE)
+
+/* bytes do cabecalho de um bloco em uso e menor area util de um bloco, que 
+   precisa comportar os campos da lista de livres */
+#define CABECALHO			offsetof(bloco_heap_t, proximo_livre)
+#define MINIMO_UTIL			(sizeof(bloco_heap_t) - CABECALHO)
+
+/* maior area util de um bloco */
+#define MAXIMO_UTIL			(((size_t)1 << HEAP_FL_INDICE_MAX) - HEAP_ALINHAMENTO)
+
+/* tabela de De Bruijn para achar o bit mais significativo sem a instrucao
+   CLZ, que nao existe no Cortex-M0 */
+static const uint8_t tabela_debruijn[32] = 
+{
+	0, 9, 1, 10, 13, 21, 2, 29, 11, 14, 16, 18, 22, 25, 3, 30,
+	8, 12, 20, 28, 15, 17, 24, 7, 19, 27, 23, 6, 26, 5, 4, 31
+};
+
+static uint8_t BitMaisAlto(uint32_t valor)
+{
+	valor |= valor >> 1;
+	valor |= valor >> 2;
+	valor |= valor >> 4;
+	valor |= valor >> 8;
+	valor |= valor >> 16;
+	
+	return tabela_debruijn[(uint32_t)(valor * 0x07C4ACDDUL) >> 27];
+}
+
+static uint8_t BitMaisBaixo(uint32_t valor)
+{
+	return BitMaisAlto(valor & (~valor + 1));	/* isola o bit ativo menos significativo */
+}
+
+static size_t Tamanho(const bloco_heap_t *bloco)
+{
+	return bloco->tamanho & ~BLOCO_INDICADORES;
+}
+
+static bloco_heap_t *ProximoFisico(const bloco_heap_t *bloco)
+{
+	return (bloco_heap_t *)((uint8_t *)bloco + CABECALHO + Tamanho(bloco));
+}
+
+/* listas (fl, sl) onde fica um bloco livre do tamanho dado */
+static void MapeiaInsercao(size_t tamanho, uint8_t *fl, uint8_t *sl)
+{
+	uint8_t bit;
+	
+	if(tamanho < ((size_t)1 << HEAP_FL_DESLOCAMENTO))
+	{
+		*fl = 0;
+		*sl = (uint8_t)(tamanho >> HEAP_ALINHAMENTO_LOG2);
+	}else
+	{
+		bit = BitMaisAlto((uint32_t)tamanho);
+		*sl = (uint8_t)((tamanho >> (bit - HEAP_SL_LOG2)) ^ HEAP_SL_NUMERO);
+		*fl = (uint8_t)(bit - HEAP_FL_DESLOCAMENTO + 1);
+	}
+}
+
+/* primeira lista (fl, sl) em que todos os blocos tem pelo menos o tamanho dado:
+   o tamanho eh arredondado para o inicio da faixa seguinte */
+static void MapeiaBusca(size_t tamanho, uint8_t *fl, uint8_t *sl)
+{
+	if(tamanho >= ((size_t)1 << HEAP_FL_DESLOCAMENTO))
+	{
+		tamanho += ((size_t)1 << (BitMaisAlto((uint32_t)tamanho) - HEAP_SL_LOG2)) - 1;
+	}
+	MapeiaInsercao(tamanho, fl, sl);
+}
+
+static void InsereLivre(heap_t *heap, bloco_heap_t *bloco)
+{
+	uint8_t fl, sl;
+	
+	MapeiaInsercao(Tamanho(bloco), &fl, &sl);
+	
+	bloco->anterior_livre = NULL;
+	bloco->proximo_livre = heap->livres[fl][sl];
+	if(bloco->proximo_livre != NULL)
+	{
+		bloco->proximo_livre->anterior_livre = bloco;
+	}
+	heap->livres[fl][sl] = bloco;
+	
+	heap->mapa_fl |= (uint32_t)1 << fl;
+	heap->mapa_sl[fl] |= (uint8_t)(1 << sl);
+	heap->livre += Tamanho(bloco);
+}
+
+static void RetiraLivre(heap_t *heap, bloco_heap_t *bloco)
+{
+	uint8_t fl, sl;
+	
+	MapeiaInsercao(Tamanho(bloco), &fl, &sl);
+	
+	if(bloco->proximo_livre != NULL)
+	{
+		bloco->proximo_livre->anterior_livre = bloco->anterior_livre;
+	}
+	if(bloco->anterior_livre != NULL)
+	{
+		bloco->anterior_livre->proximo_livre = bloco->proximo_livre;
+	}else
+	{
+		heap->livres[fl][sl] = bloco->proximo_livre;
+		if(heap->livres[fl][sl] == NULL)
+		{
+			heap->mapa_sl[fl] &= (uint8_t)~(1 << sl);
+			if(heap->mapa_sl[fl] == 0)
+			{
+				heap->mapa_fl &= ~((uint32_t)1 << fl);
+			}
+		}
+	}
+	heap->livre -= Tamanho(bloco);
+}
+
+/* prepara o heap na area dada. O ultimo cabecalho da area eh um bloco vazio 
+   sempre em uso, que marca o fim do heap. Retorna 0 se a area eh pequena demais */
+uint8_t HeapTLSFInicia(heap_t* heap, void* area, size_t tamanho)
+{
+	uintptr_t inicio = ((uintptr_t)area + HEAP_ALINHAMENTO - 1) & ~(uintptr_t)(HEAP_ALINHAMENTO - 1);
+	bloco_heap_t *bloco, *fim;
+	size_t util;
+	uint8_t i, j;
+	
+	heap->mapa_fl = 0;
+	for(i = 0; i < HEAP_FL_NUMERO; i++)
+	{
+		heap->mapa_sl[i] = 0;
+		for(j = 0; j < HEAP_SL_NUMERO; j++)
+		{
+			heap->livres[i][j] = NULL;
+		}
+	}
+	heap->total = 0;
+	heap->livre = 0;
+	heap->livre_minimo = 0;
+	heap->falhas = 0;
+	
+	tamanho -= (size_t)(inicio - (uintptr_t)area);
+	if(tamanho < 2 * CABECALHO + MINIMO_UTIL || tamanho > ((size_t)~(size_t)0) - HEAP_ALINHAMENTO)
+	{
+		return 0;
+	}
+	
+	util = (tamanho - 2 * CABECALHO) & ~(size_t)(HEAP_ALINHAMENTO - 1);
+	if(util > MAXIMO_UTIL)
+	{
+		util = MAXIMO_UTIL;		/* o restante da area nao eh usado */
+	}
+	
+	bloco = (bloco_heap_t *)inicio;
+	bloco->anterior_fisico = NULL;
+	bloco->tamanho = util | BLOCO_LIVRE;
+	
+	fim = ProximoFisico(bloco);
+	fim->anterior_fisico = bloco;
+	fim->tamanho = BLOCO_ANTERIOR_LIVRE;
+	
+	InsereLivre(heap, bloco);
+	heap->total = util;
+	heap->livre_minimo = util;
+	
+	return 1;
+}
+
+/* aloca um bloco com pelo menos tamanho bytes, alinhado para ponteiros, ou 
+   retorna NULL. O tempo nao depende do numero de blocos */
+void* HeapTLSFAloca(heap_t* heap, size_t tamanho)
+{
+	bloco_heap_t *bloco, *resto;
+	uint32_t mapa;
+	uint8_t fl, sl;
+	
+	if(tamanho == 0 || tamanho > MAXIMO_UTIL)
+	{
+		heap->falhas++;
+		return NULL;
+	}
+	
+	tamanho = (tamanho + HEAP_ALINHAMENTO - 1) & ~(size_t)(HEAP_ALINHAMENTO - 1);
+	if(tamanho < MINIMO_UTIL)
+	{
+		tamanho = MINIMO_UTIL;
+	}
+	
+	/* procura uma lista nao vazia a partir de (fl, sl): primeiro no mesmo 
+	   primeiro nivel, depois nos niveis maiores */
+	MapeiaBusca(tamanho, &fl, &sl);
+	mapa = (fl < HEAP_FL_NUMERO) ? (heap->mapa_sl[fl] & (~(uint32_t)0 << sl)) : 0;
+	if(mapa == 0)
+	{
+		mapa = (fl + 1 < 32) ? (heap->mapa_fl & (~(uint32_t)0 << (fl + 1))) : 0;
+		if(mapa == 0)
+		{
+			heap->falhas++;
+			return NULL;
+		}
+		fl = BitMaisBaixo(mapa);
+		mapa = heap->mapa_sl[fl];
+	}
+	sl = BitMaisBaixo(mapa);
+	
+	bloco = heap->livres[fl][sl];
+	RetiraLivre(heap, bloco);
+	
+	/* a sobra vira um novo bloco livre, se comportar um bloco minimo */
+	if(Tamanho(bloco) >= tamanho + sizeof(bloco_heap_t))
+	{
+		resto = (bloco_heap_t *)((uint8_t *)bloco + CABECALHO + tamanho);
+		resto->anterior_fisico = bloco;
+		resto->tamanho = (Tamanho(bloco) - tamanho - CABECALHO) | BLOCO_LIVRE;
+		ProximoFisico(resto)->anterior_fisico = resto;
+		bloco->tamanho = tamanho | (bloco->tamanho & BLOCO_INDICADORES);
+		InsereLivre(heap, resto);
+	}else
+	{
+		ProximoFisico(bloco)->tamanho &= ~BLOCO_ANTERIOR_LIVRE;
+	}
+	bloco->tamanho &= ~BLOCO_LIVRE;
+	
+	if(heap->livre < heap->livre_minimo)
+	{
+		heap->livre_minimo = heap->livre;
+	}
+	
+	return (uint8_t *)bloco + CABECALHO;
+}
+
+/* libera o bloco, juntando-o aos vizinhos livres na memoria */
+void HeapTLSFLibera(heap_t* heap, void* ptr)
+{
+	bloco_heap_t *bloco, *vizinho;
+	
+	if(ptr == NULL)
+	{
+		return;
+	}
+	
+	bloco = (bloco_heap_t *)((uint8_t *)ptr - CABECALHO);
+	bloco->tamanho |= BLOCO_LIVRE;
+	
+	if(bloco->tamanho & BLOCO_ANTERIOR_LIVRE)
+	{
+		vizinho = bloco->anterior_fisico;
+		RetiraLivre(heap, vizinho);
+		vizinho->tamanho += CABECALHO + Tamanho(bloco);
+		bloco = vizinho;
+		ProximoFisico(bloco)->anterior_fisico = bloco;
+	}
+	
+	vizinho = ProximoFisico(bloco);
+	if(vizinho->tamanho & BLOCO_LIVRE)
+	{
+		RetiraLivre(heap, vizinho);
+		bloco->tamanho += CABECALHO + Tamanho(vizinho);
+		ProximoFisico(bloco)->anterior_fisico = bloco;
+	}
+	
+	ProximoFisico(bloco)->tamanho |= BLOCO_ANTERIOR_LIVRE;
+	InsereLivre(heap, bloco);
+}
+
+/* percorre as listas de livres; o tempo depende do numero de blocos livres, 
+   por isso nao deve ser chamada em trechos de tempo critico */
+void HeapTLSFEstatisticas(heap_t* heap, heap_estatisticas_t* estatisticas)
+{
+	bloco_heap_t *bloco;
+	uint8_t fl, sl;
+	
+	estatisticas->livre = heap->livre;
+	estatisticas->livre_minimo = heap->livre_minimo;
+	estatisticas->maior_livre = 0;
+	estatisticas->blocos_livres = 0;
+	estatisticas->falhas = heap->falhas;
+	
+	for(fl = 0; fl < HEAP_FL_NUMERO; fl++)
+	{
+		for(sl = 0; sl < HEAP_SL_NUMERO; sl++)
+		{
+			for(bloco = heap->livres[fl][sl]; bloco != NULL; bloco = bloco->proximo_livre)
+			{
+				estatisticas->blocos_livres++;
+				if(Tamanho(bloco) > estatisticas->maior_livre)
+				{
+					estatisticas->maior_livre = Tamanho(bloco);
+				}
+			}
+		}
+	}
+	
+	estatisticas->fragmentacao = (heap->livre == 0) ? 0 :
+		(uint8_t)(100 - (uint32_t)(((uint64_t)estatisticas->maior_livre * 100) / heap->livre));
+}
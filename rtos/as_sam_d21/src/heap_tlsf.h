@@ -0,0 +1,102 @@
+/*
+ * heap_tlsf.h
+ *
+ */
+
+
+#ifndef HEAP_TLSF_H_
+#define HEAP_TLSF_H_
+
+#include "stdint.h"
+#include "stddef.h"
+
+/* heap de tamanho variavel com alocacao e liberacao em tempo constante
+   (TLSF - two-level segregated fit). Os blocos livres ficam em listas separadas
+   por faixa de tamanho: o primeiro nivel eh a potencia de 2 do tamanho e o
+   segundo divide cada potencia em HEAP_SL_NUMERO faixas. Mapas de bits dos dois
+   niveis indicam as listas nao vazias, assim a busca de um bloco livre e a
+   juncao com os vizinhos livres nao dependem do numero de blocos.
+   Nao usa o sistema multitarefas; o acesso concorrente deve ser protegido por
+   quem chama (ver HeapAloca/HeapLibera em rtos.h) */
+
+/* log2 do maior tamanho de bloco suportado (16 = 64 KB) */
+#ifndef HEAP_FL_INDICE_MAX
+#define HEAP_FL_INDICE_MAX		16
+#endif
+
+#if HEAP_FL_INDICE_MAX > 31
+#error "HEAP_FL_INDICE_MAX deve ser menor ou igual a 31"
+#endif
+
+/* log2 do numero de faixas do segundo nivel */
+#define HEAP_SL_LOG2			3
+#define HEAP_SL_NUMERO			(1 << HEAP_SL_LOG2)
+
+/* alinhamento dos blocos: tamanho de um ponteiro */
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#define HEAP_ALINHAMENTO_LOG2	3
+#else
+#define HEAP_ALINHAMENTO_LOG2	2
+#endif
+#define HEAP_ALINHAMENTO		(1 << HEAP_ALINHAMENTO_LOG2)
+
+/* blocos menores que 2^HEAP_FL_DESLOCAMENTO ficam todos no primeiro nivel 0,
+   em faixas de HEAP_ALINHAMENTO bytes */
+#define HEAP_FL_DESLOCAMENTO	(HEAP_SL_LOG2 + HEAP_ALINHAMENTO_LOG2)
+#define HEAP_FL_NUMERO			(HEAP_FL_INDICE_MAX - HEAP_FL_DESLOCAMENTO + 1)
+
+#if HEAP_FL_NUMERO > 32
+#error "HEAP_FL_INDICE_MAX muito grande para o mapa de bits do primeiro nivel"
+#endif
+
+/**
+* \struct bloco_heap_t
+* Cabecalho de um bloco do heap. Os campos de lista de livres ocupam o inicio
+* da area util e so existem enquanto o bloco esta livre.
+*/
+
+typedef struct bloco_heap
+{
+	struct bloco_heap	*anterior_fisico;	///< Bloco imediatamente anterior na memoria
+	size_t				tamanho;			///< Tamanho da area util; bits 0 e 1 sao indicadores
+	struct bloco_heap	*proximo_livre;		///< Proximo bloco na lista de livres
+	struct bloco_heap	*anterior_livre;	///< Bloco anterior na lista de livres
+} bloco_heap_t;
+
+/**
+* \struct heap_t
+* Estrutura de controle do heap
+*/
+
+typedef struct
+{
+	uint32_t		mapa_fl;								///< Bit f: ha bloco livre no primeiro nivel f
+	uint8_t			mapa_sl[HEAP_FL_NUMERO];				///< Bit s: a lista [f][s] nao esta vazia
+	bloco_heap_t	*livres[HEAP_FL_NUMERO][HEAP_SL_NUMERO];	///< Listas de blocos livres
+	size_t			total;									///< Bytes uteis do heap
+	size_t			livre;									///< Bytes uteis livres
+	size_t			livre_minimo;							///< Menor valor de livre desde o inicio
+	uint32_t		falhas;									///< Alocacoes que nao foram atendidas
+} heap_t;
+
+/**
+* \struct heap_estatisticas_t
+* Estatisticas de ocupacao e fragmentacao do heap
+*/
+
+typedef struct
+{
+	size_t		livre;				///< Bytes uteis livres
+	size_t		livre_minimo;		///< Menor valor de livre desde o inicio
+	size_t		maior_livre;		///< Maior bloco livre: maior alocacao possivel
+	uint32_t	blocos_livres;		///< Numero de blocos livres
+	uint32_t	falhas;				///< Alocacoes que nao foram atendidas
+	uint8_t		fragmentacao;		///< 100 * (1 - maior_livre / livre), em %
+} heap_estatisticas_t;
+
+uint8_t HeapTLSFInicia(heap_t* heap, void* area, size_t tamanho);
+void* HeapTLSFAloca(heap_t* heap, size_t tamanho);
+void HeapTLSFLibera(heap_t* heap, void* ptr);
+void HeapTLSFEstatisticas(heap_t* heap, heap_estatisticas_t* estatisticas);
+
+#endif /* HEAP_TLSF_H_ */
@@ -82,11 +82,13 @@ uint32_t PILHA_TAREFA_8[TAM_PILHA_8];
 uint32_t PILHA_TAREFA_9[TAM_PILHA_9];
 uint32_t PILHA_TAREFA_10[TAM_PILHA_10];
 
+#if !cfg_TABELA_ESTATICA_TAREFAS  /* senao as pilhas sao declaradas pelo sistema */
 /* --- ADICIONADO PARA O EXEMPLO PERIÓDICO --- */
 uint32_t PILHA_TAREFA_PERIODICA[TAM_PILHA_PERIODICA];
 uint32_t PILHA_TAREFA_INTENSIVA[TAM_PILHA_INTENSIVA];
 
 uint32_t PILHA_TAREFA_OCIOSA[TAM_PILHA_OCIOSA];
+#endif
 
 /*
  * Semaforos e variaveis globais
@@ -94,13 +96,13 @@ uint32_t PILHA_TAREFA_OCIOSA[TAM_PILHA_OCIOSA];
 semaforo_t SemaforoTeste = {0,0}; /* declaracao e inicializacao de um semaforo */
 
 #define TAM_BUFFER 10
-uint8_t buffer[TAM_BUFFER]; /* declaracao de um buffer (vetor) ou fila circular */
-semaforo_t SemaforoCheio = {0,0}; /* declaracao e inicializacao de um semaforo */
-semaforo_t SemaforoVazio = {TAM_BUFFER,0}; /* declaracao e inicializacao de um semaforo */
+uint8_t buffer[TAM_BUFFER]; /* area de armazenamento da fila de mensagens */
+fila_mensagens_t FilaProdutorConsumidor = FILA_MENSAGENS_INICIALIZADOR(buffer, sizeof(uint8_t), TAM_BUFFER);
+volatile uint32_t itens_fora_de_ordem = 0; /* itens recebidos fora da sequencia do produtor */
 
 /* Variaveis para o exemplo de mutex (tarefas 9 e 10) */
 volatile uint32_t recurso_compartilhado = 0; /* Variavel compartilhada entre tarefas */
-semaforo_t MutexRecurso = {1,0}; /* Mutex (semaforo binario com valor inicial 1) para proteger o recurso */
+mutex_t MutexRecurso = {0,0,0,NULL}; /* Mutex com heranca de prioridade para proteger o recurso */
 
 /*
  * Funcao principal de entrada do sistema
@@ -133,15 +135,28 @@ int main(void)
      * 1. tarefa_periodica: Alta prioridade (4), pisca um LED a cada 100ms.
      * 2. tarefa_cpu_intensiva: Baixa prioridade (1), apenas executa um loop infinito para "gastar" CPU.
      */
+#if !cfg_TABELA_ESTATICA_TAREFAS
     CriaTarefa(tarefa_periodica, "Tarefa Periodica", PILHA_TAREFA_PERIODICA, TAM_PILHA_PERIODICA, 4);
     CriaTarefa(tarefa_cpu_intensiva, "Tarefa Intensiva", PILHA_TAREFA_INTENSIVA, TAM_PILHA_INTENSIVA, 1);
     
     /* Cria tarefa ociosa do sistema */
     CriaTarefa(tarefa_ociosa,"Tarefa ociosa", PILHA_TAREFA_OCIOSA, TAM_PILHA_OCIOSA, 0);
+#else
+    /* com a tabela estatica (config/conf_tarefas.h) as mesmas tarefas ja estao
+       criadas em tempo de compilacao */
+#endif
     
     /* Configura marca de tempo */
     ConfiguraMarcaTempo();  
     
+    /* Para comparar com o sistema cooperativo, desligue o modo preemptivo */
+    // ConfiguraModoPreemptivo(0);
+    
+#if cfg_TRACO > 0
+    /* mede o custo de um registro do traco, mostrado pelo decodificador */
+    TracoMedeCusto();
+#endif
+    
     /* Inicia sistema multitarefas */
     IniciaMultitarefas();
     
@@ -241,16 +256,11 @@ void tarefa_7(void) /* Produtor */
 {
 
     uint8_t a = 1;          /* inicializacoes para a tarefa */
-    uint8_t i = 0;
     
     for(;;)
     {
-        SemaforoAguarda(&SemaforoVazio);
-        
-        buffer[i] = a++;
-        i = (i+1)%TAM_BUFFER;
-        
-        SemaforoLibera(&SemaforoCheio); /* tarefa libera semaforo para tarefa que esta esperando-o */
+        FilaEnvia(&FilaProdutorConsumidor, &a, ESPERA_INFINITA); /* espera se a fila estiver cheia */
+        a++;
         
         TarefaEspera(10);   /* tarefa se coloca em espera por 10 marcas de tempo (ticks), equivale a 10ms */         
     }
@@ -258,31 +268,23 @@ void tarefa_7(void) /* Produtor */
 
 void tarefa_8(void) /* Consumidor */
 {
-    static uint8_t f = 0;
-    volatile uint8_t valor;
+    uint8_t item;
+    uint8_t esperado = 1;   /* o produtor envia 1, 2, 3, ... */
         
     for(;;)
     {
-        volatile uint8_t contador;
-        
-        do{
-            REG_ATOMICA_INICIO();       
-                contador = SemaforoCheio.contador;          
-            REG_ATOMICA_FIM();
-            
-            if (contador == 0)
-            {
-                TarefaEspera(100);
-            }
-                
-        } while (!contador);
+        /* espera por um item na fila por no maximo 100 marcas de tempo; 
+           acorda assim que o produtor enviar um item */
+        if(FilaRecebe(&FilaProdutorConsumidor, &item, 100) != SUCESSO)
+        {
+            continue;   /* nenhum item produzido no periodo */
+        }
         
-        SemaforoAguarda(&SemaforoCheio);
-        
-        valor = buffer[f];
-        f = (f+1) % TAM_BUFFER;     
-        
-        SemaforoLibera(&SemaforoVazio);
+        if(item != esperado)
+        {
+            itens_fora_de_ordem++;
+        }
+        esperado = (uint8_t)(item + 1);
     }
 }
 
@@ -292,11 +294,11 @@ void tarefa_9(void)
 {
     for(;;)
     {
-        SemaforoAguarda(&MutexRecurso); 
+        MutexAguarda(&MutexRecurso); 
 
         recurso_compartilhado++;
         
-        SemaforoLibera(&MutexRecurso); 
+        MutexLibera(&MutexRecurso); 
 
         TarefaEspera(20);
     }
@@ -307,11 +309,11 @@ void tarefa_10(void)
     for(;;)
     {
         
-        SemaforoAguarda(&MutexRecurso); 
+        MutexAguarda(&MutexRecurso); 
 
         recurso_compartilhado++;
 
-        SemaforoLibera(&MutexRecurso); 
+        MutexLibera(&MutexRecurso); 
         
         TarefaEspera(35); 
     }
@@ -324,21 +326,25 @@ void tarefa_10(void)
  * \brief Tarefa periódica que executa a cada 100ms.
  *
  * Esta tarefa tem prioridade alta. Ela alterna o estado de um LED e depois
- * se suspende por 100 marcas de tempo (ticks), o que corresponde a 100ms
- * se o tick do sistema for de 1ms.
+ * se suspende ate completar 100 marcas de tempo (ticks) desde o ultimo 
+ * despertar, o que corresponde a 100ms se o tick do sistema for de 1ms.
  */
 void tarefa_periodica(void)
 {
+    tick_t ultimo_despertar = ObtemMarcaDeTempo();
+    
     for(;;)
     {
         /* Alterna o estado do LED */
         port_pin_toggle_output_level(LED_0_PIN);
         
         /*
-         * Suspende a tarefa por 100ms.
+         * Suspende a tarefa ate o inicio do proximo periodo de 100ms.
          * Esta chamada é crucial: ela libera o processador para outras tarefas.
+         * Diferente de TarefaEspera(100), o periodo nao acumula o tempo de
+         * execucao da propria tarefa.
          */
-        TarefaEspera(100);
+        TarefaEsperaAte(&ultimo_despertar, 100);
     }
 }
 
@@ -4,214 +4,1859 @@
  */ 
 
 #include "rtos.h"
+#include <string.h>
 
 /* variaveis do sistema multitarefas */
-uint8_t 	   tarefa_atual, proxima_tarefa;
-tcb_t   	   TCB[NUMERO_DE_TAREFAS+1];
+id_tarefa_t    tarefa_atual, proxima_tarefa;
 stackptr_t	   ponteiro_de_pilha;
-prioridade_t   Prioridades[PRIORIDADE_MAXIMA+1];   /* vetor com as prioridades das tarefas */
-uint32_t	   SP;
+id_tarefa_t    Prioridades[PRIORIDADE_MAXIMA+1];   /* vetor com a fila de tarefas prontas de cada prioridade */
+stackptr_t	   SP;
 
 /* variavel auxiliar para guardar o numero de marcas de tempo */
-static tick_t contador_marcas = 0;
+static tick_t contador_marcas = (tick_t)(cfg_MARCA_TEMPO_INICIAL);
+
+#if cfg_TABELA_ESTATICA_TAREFAS
+/* declara as funcoes e as pilhas das tarefas da tabela e verifica, durante a
+   compilacao, a prioridade e o tamanho da pilha de cada uma */
+#define DECLARA_TAREFA(funcao, nome_tarefa, tamanho_pilha, prio)							\
+	void funcao(void);																	\
+	static uint32_t pilha_##funcao[tamanho_pilha];										\
+	_Static_assert((prio) <= PRIORIDADE_MAXIMA, #funcao ": prioridade maior que PRIORIDADE_MAXIMA");	\
+	_Static_assert((prio) > 0, #funcao ": a prioridade 0 eh da tarefa ociosa");			\
+	_Static_assert((tamanho_pilha) >= TAM_MINIMO_PILHA, #funcao ": pilha menor que TAM_MINIMO_PILHA");
+
+TABELA_TAREFAS(DECLARA_TAREFA)
+static uint32_t pilha_tarefa_ociosa[TAM_PILHA_OCIOSA_TABELA];
+_Static_assert(TAM_PILHA_OCIOSA_TABELA >= TAM_MINIMO_PILHA, "tarefa_ociosa: pilha menor que TAM_MINIMO_PILHA");
+_Static_assert(NUMERO_DE_TAREFAS < (id_tarefa_t)~(id_tarefa_t)0, "tarefas demais para id_tarefa_t");
+
+/* os TCBs ja comecam preenchidos, com o ponteiro de pilha no contexto inicial */
+#if cfg_VERIFICA_PILHA
+#define TCB_PILHA(funcao, tamanho)	.pilha_inicio = pilha_##funcao, .tamanho_pilha = (tamanho),
+#else
+#define TCB_PILHA(funcao, tamanho)
+#endif
+#if cfg_MODO_PREEMPTIVO && cfg_QUANTUM_MARCAS > 0
+#define TCB_FATIA		.fatia_restante = cfg_QUANTUM_MARCAS,
+#else
+#define TCB_FATIA
+#endif
+#define TCB_TAREFA(funcao, nome_tarefa, tamanho, prio)									\
+	{ .nome = nome_tarefa, .stack_pointer = &pilha_##funcao[(tamanho) - TAM_CONTEXTO],		\
+	  TCB_PILHA(funcao, tamanho) TCB_FATIA												\
+	  .estado = ESPERA, .prioridade = prio, .prioridade_base = prio },
+
+tcb_t   	   TCB[NUMERO_DE_TAREFAS+1] = 
+{
+	{ .nome = NULL },
+	TABELA_TAREFAS(TCB_TAREFA)
+	TCB_TAREFA(tarefa_ociosa, "Tarefa ociosa", TAM_PILHA_OCIOSA_TABELA, 0)
+};
+
+#define FUNCAO_TAREFA(funcao, nome_tarefa, tamanho_pilha, prio)		funcao,
+static const tarefa_t funcoes_tarefas[] = 
+{
+	NULL, TABELA_TAREFAS(FUNCAO_TAREFA) tarefa_ociosa
+};
+
+#define TAMANHO_PILHA_TAREFA(funcao, nome_tarefa, tamanho_pilha, prio)	tamanho_pilha,
+static const uint16_t tamanhos_pilhas[] = 
+{
+	0, TABELA_TAREFAS(TAMANHO_PILHA_TAREFA) TAM_PILHA_OCIOSA_TABELA
+};
+
+#define NUMERO_TAREFAS_TABELA	(TABELA_TAREFAS(CONTA_TAREFA) + 1)
+static id_tarefa_t numero_tarefas = NUMERO_TAREFAS_TABELA;
+#else
+tcb_t   	   TCB[NUMERO_DE_TAREFAS+1];
+
+static id_tarefa_t numero_tarefas = 0;
+#endif
+
+#if cfg_MODO_PREEMPTIVO
+/* modo de operacao: 1 = preemptivo, 0 = cooperativo */
+volatile uint8_t modo_preemptivo = 1;
+
+#if cfg_QUANTUM_MARCAS > 0
+/* numero de trocas de contexto pedidas pelo fim de uma fatia de tempo, 
+   isto e, as trocas a mais que a divisao do tempo entre tarefas de mesma
+   prioridade provoca (so no modo preemptivo) */
+volatile uint32_t trocas_por_fatia = 0;
+#endif
+#endif
+
+#if cfg_MEDE_TEMPO_TAREFAS
+/* instantes, em ciclos de clock, em que a tarefa atual entrou em execucao e em
+   que a janela de medicao do uso da CPU comecou, e marcas de tempo que faltam
+   para o fim da janela */
+static uint32_t inicio_execucao = 0;
+static uint32_t inicio_janela = 0;
+static tick_t marcas_janela = cfg_JANELA_USO_CPU;
+#endif
+
+#if cfg_TRACO > 0
+traco_t traco = 
+{
+	.identificador = TRACO_IDENTIFICADOR,
+	.frequencia = cfg_CPU_CLOCK_HZ,
+	.numero_registros = cfg_TRACO,
+	.numero_nomes = NUMERO_DE_TAREFAS+1,
+};
+
+/* escreve um registro no traco, sobrescrevendo o mais antigo se o buffer esta
+   cheio. Chamada com as interrupcoes desabilitadas */
+static void TracoRegistra(uint8_t evento, id_tarefa_t tarefa, uint16_t dado)
+{
+	registro_traco_t *registro = &traco.registros[traco.indice & (cfg_TRACO - 1)];
+	
+	registro->tempo = LeContadorDeCiclos();
+	registro->dado = dado;
+	registro->evento = evento;
+	registro->tarefa = (uint8_t)tarefa;
+	traco.indice++;
+}
+
+#define TRACO(evento, tarefa, dado)		TracoRegistra((evento), (tarefa), (uint16_t)(dado))
+#else
+#define TRACO(evento, tarefa, dado)
+#endif
+
+#if cfg_PERFIL > 0
+perfil_t perfil = 
+{
+	.identificador = PERFIL_IDENTIFICADOR,
+	.frequencia = cfg_MARCA_TEMPO_HZ,
+	.numero_amostras = cfg_PERFIL,
+	.numero_nomes = NUMERO_DE_TAREFAS+1,
+};
+
+/* guarda no perfil o PC da tarefa interrompida. Chamada pela interrupcao de 
+   amostragem (ENTRADA_PERFIL em cpu-port.h), que le o PC do contexto salvo
+   na pilha */
+void PerfilRegistra(uint32_t pc)
+{
+	uint32_t posicao = perfil.indice & (cfg_PERFIL - 1);
+	
+	perfil.pc[posicao] = pc;
+	perfil.tarefa[posicao] = (uint8_t)tarefa_atual;
+	perfil.indice++;
+}
+#endif
+
+#if cfg_TRACO > 0 || cfg_PERFIL > 0
+/* copia o nome da tarefa para os cabecalhos do traco e do perfil, onde as 
+   ferramentas do computador o encontram */
+static void CopiaNomeTarefa(id_tarefa_t tarefa)
+{
+	const char *nome = (TCB[tarefa].nome != NULL) ? TCB[tarefa].nome : "";
+	
+#if cfg_TRACO > 0
+	strncpy(traco.nomes[tarefa], nome, TRACO_TAM_NOME);
+#endif
+#if cfg_PERFIL > 0
+	strncpy(perfil.nomes[tarefa], nome, PERFIL_TAM_NOME);
+#endif
+}
+#endif
+
+/* tarefas terminadas cuja pilha e TCB ainda nao foram liberados pela tarefa
+   ociosa, encadeadas pelo campo proxima do TCB */
+static id_tarefa_t lista_terminadas = 0;
+
+#if cfg_PILHAS_DINAMICAS > 0
+/* conjunto de pilhas das tarefas criadas com TarefaCria */
+static POOL_MEMORIA_AREA(area_pilhas, cfg_TAM_PILHA_DINAMICA * sizeof(uint32_t), cfg_PILHAS_DINAMICAS);
+static pool_memoria_t pool_pilhas;
+static uint8_t pool_pilhas_iniciado = 0;
+#endif
+
+/* mapa de bits das prioridades que tem tarefa pronta para executar:
+   o bit p esta ativo quando a fila Prioridades[p] nao esta vazia */
+#define PALAVRAS_MAPA_PRONTAS	((PRIORIDADE_MAXIMA / 32) + 1)
+static uint32_t mapa_prontas[PALAVRAS_MAPA_PRONTAS];
+
+/* tabela de De Bruijn usada para encontrar o bit mais significativo 
+   sem a instrucao CLZ, que nao existe no Cortex-M0 */
+static const uint8_t tabela_debruijn[32] = 
+{
+	0, 9, 1, 10, 13, 21, 2, 29, 11, 14, 16, 18, 22, 25, 3, 30,
+	8, 12, 20, 28, 15, 17, 24, 7, 19, 27, 23, 6, 26, 5, 4, 31
+};
+
+/* retorna a posicao do bit ativo mais significativo (0 se valor == 0),
+   em tempo constante: propaga o bit mais alto para a direita e 
+   usa a multiplicacao pela constante de De Bruijn como indice da tabela */
+static uint8_t BitMaisAlto(uint32_t valor)
+{
+	valor |= valor >> 1;
+	valor |= valor >> 2;
+	valor |= valor >> 4;
+	valor |= valor >> 8;
+	valor |= valor >> 16;
+	
+	return tabela_debruijn[(uint32_t)(valor * 0x07C4ACDDUL) >> 27];
+}
+
+static void MarcaPrioridadePronta(prioridade_t prioridade)
+{
+	mapa_prontas[prioridade >> 5] |= (1UL << (prioridade & 31));
+}
+
+static void DesmarcaPrioridadePronta(prioridade_t prioridade)
+{
+	mapa_prontas[prioridade >> 5] &= ~(1UL << (prioridade & 31));
+}
 
-static uint8_t numero_tarefas = 0;
+/* retorna a maior prioridade que tem tarefa pronta para executar */
+static prioridade_t MaiorPrioridadePronta(void)
+{
+#if PALAVRAS_MAPA_PRONTAS > 1
+	if(mapa_prontas[1] != 0)
+	{
+		return (prioridade_t)(32 + BitMaisAlto(mapa_prontas[1]));
+	}
+#endif
+	return BitMaisAlto(mapa_prontas[0]);
+}
+
+/* listas circulares duplamente encadeadas de tarefas, formadas pelos campos
+   proxima/anterior do TCB. Uma lista eh representada pela sua primeira tarefa
+   (0 = lista vazia), e insercao e remocao sao feitas em tempo constante */
+static void ListaInsereAntes(id_tarefa_t posicao, id_tarefa_t tarefa)
+{
+	id_tarefa_t anterior = TCB[posicao].anterior;
+	
+	TCB[tarefa].proxima = posicao;
+	TCB[tarefa].anterior = anterior;
+	TCB[anterior].proxima = tarefa;
+	TCB[posicao].anterior = tarefa;
+}
+
+static void ListaInsereNoFim(id_tarefa_t *lista, id_tarefa_t tarefa)
+{
+	if(*lista == 0)
+	{
+		TCB[tarefa].proxima = tarefa;
+		TCB[tarefa].anterior = tarefa;
+		*lista = tarefa;
+	}else
+	{
+		ListaInsereAntes(*lista, tarefa);	/* antes da primeira = no fim */
+	}
+}
+
+/* insere a tarefa em uma fila de espera ordenada por prioridade (a primeira
+   tarefa eh a de maior prioridade) e, dentro da mesma prioridade, por ordem 
+   de chegada */
+static void ListaInserePorPrioridade(id_tarefa_t *lista, id_tarefa_t tarefa)
+{
+	id_tarefa_t atual = *lista;
+	
+	if(atual == 0)
+	{
+		ListaInsereNoFim(lista, tarefa);
+		return;
+	}
+	
+	/* procura a primeira tarefa com prioridade menor que a da tarefa inserida */
+	do
+	{
+		if(TCB[atual].prioridade < TCB[tarefa].prioridade)
+		{
+			ListaInsereAntes(atual, tarefa);
+			if(atual == *lista)
+			{
+				*lista = tarefa;	/* passa a ser a primeira da fila */
+			}
+			return;
+		}
+		atual = TCB[atual].proxima;
+	}while(atual != *lista);
+	
+	ListaInsereNoFim(lista, tarefa);
+}
+
+static void ListaRemove(id_tarefa_t *lista, id_tarefa_t tarefa)
+{
+	id_tarefa_t proxima = TCB[tarefa].proxima;
+	id_tarefa_t anterior = TCB[tarefa].anterior;
+	
+	if(proxima == tarefa)
+	{
+		*lista = 0;		/* era a unica tarefa da lista */
+	}else
+	{
+		TCB[anterior].proxima = proxima;
+		TCB[proxima].anterior = anterior;
+		if(*lista == tarefa)
+		{
+			*lista = proxima;
+		}
+	}
+	TCB[tarefa].proxima = 0;
+	TCB[tarefa].anterior = 0;
+}
+
+/* coloca a tarefa no fim da fila de prontas da sua prioridade */
+static void ColocaNaFilaDeProntas(id_tarefa_t tarefa)
+{
+	prioridade_t prioridade = TCB[tarefa].prioridade;
+	
+	if(TCB[tarefa].estado == PRONTA)
+	{
+		return;		/* ja esta na fila de prontas */
+	}
+	
+	TCB[tarefa].estado = PRONTA;
+	TRACO(TRACO_PRONTA, tarefa, prioridade);
+	ListaInsereNoFim(&Prioridades[prioridade], tarefa);
+	MarcaPrioridadePronta(prioridade);
+}
+
+/* retira a tarefa da fila de prontas da sua prioridade */
+static void RetiraDaFilaDeProntas(id_tarefa_t tarefa)
+{
+	prioridade_t prioridade = TCB[tarefa].prioridade;
+	
+	if(TCB[tarefa].estado != PRONTA)
+	{
+		return;		/* nao esta na fila de prontas */
+	}
+	
+	TCB[tarefa].estado = ESPERA;
+	TRACO(TRACO_BLOQUEIA, tarefa, prioridade);
+	ListaRemove(&Prioridades[prioridade], tarefa);
+	if(Prioridades[prioridade] == 0)
+	{
+		DesmarcaPrioridadePronta(prioridade);
+	}
+}
+
+/* lista de tarefas que esperam por tempo, ordenada pelo instante de despertar.
+   Cada tarefa guarda em tempo_espera somente a diferenca (delta) em marcas de
+   tempo para a tarefa anterior da lista. Assim, a cada marca de tempo apenas
+   a primeira tarefa da lista eh decrementada */
+static id_tarefa_t lista_temporizada = 0;
+
+static uint8_t EstaNaListaTemporizada(id_tarefa_t tarefa)
+{
+	return (lista_temporizada == tarefa) || (TCB[tarefa].anterior_temporizada != 0);
+}
+
+static void InsereNaListaTemporizada(id_tarefa_t tarefa, tick_t qtas_marcas)
+{
+	id_tarefa_t anterior = 0;
+	id_tarefa_t atual = lista_temporizada;
+	
+	/* percorre a lista descontando os deltas ate achar a posicao da tarefa; 
+	   tarefas com o mesmo instante de despertar ficam em ordem de chegada */
+	while(atual != 0 && TCB[atual].tempo_espera <= qtas_marcas)
+	{
+		qtas_marcas -= TCB[atual].tempo_espera;
+		anterior = atual;
+		atual = TCB[atual].proxima_temporizada;
+	}
+	
+	TCB[tarefa].tempo_espera = qtas_marcas;
+	TCB[tarefa].anterior_temporizada = anterior;
+	TCB[tarefa].proxima_temporizada = atual;
+	
+	if(atual != 0)
+	{
+		TCB[atual].tempo_espera -= qtas_marcas;
+		TCB[atual].anterior_temporizada = tarefa;
+	}
+	
+	if(anterior != 0)
+	{
+		TCB[anterior].proxima_temporizada = tarefa;
+	}else
+	{
+		lista_temporizada = tarefa;
+	}
+}
+
+static void RetiraDaListaTemporizada(id_tarefa_t tarefa)
+{
+	id_tarefa_t anterior = TCB[tarefa].anterior_temporizada;
+	id_tarefa_t proxima = TCB[tarefa].proxima_temporizada;
+	
+	if(!EstaNaListaTemporizada(tarefa))
+	{
+		return;
+	}
+	
+	/* o tempo restante da tarefa retirada passa para a proxima da lista */
+	if(proxima != 0)
+	{
+		TCB[proxima].tempo_espera += TCB[tarefa].tempo_espera;
+		TCB[proxima].anterior_temporizada = anterior;
+	}
+	
+	if(anterior != 0)
+	{
+		TCB[anterior].proxima_temporizada = proxima;
+	}else
+	{
+		lista_temporizada = proxima;
+	}
+	
+	TCB[tarefa].tempo_espera = 0;
+	TCB[tarefa].proxima_temporizada = 0;
+	TCB[tarefa].anterior_temporizada = 0;
+}
+
+/* muda a prioridade efetiva da tarefa, mantendo a fila onde ela esta 
+   (de prontas ou de espera) ordenada. A tarefa atual vai para o inicio da
+   fila da nova prioridade, para continuar executando */
+static void MudaPrioridade(id_tarefa_t tarefa, prioridade_t prioridade)
+{
+	if(TCB[tarefa].prioridade == prioridade)
+	{
+		return;
+	}
+	
+	if(TCB[tarefa].estado == PRONTA)
+	{
+		RetiraDaFilaDeProntas(tarefa);
+		TCB[tarefa].prioridade = prioridade;
+		ColocaNaFilaDeProntas(tarefa);
+		if(tarefa == tarefa_atual)
+		{
+			Prioridades[prioridade] = tarefa;	/* lista circular: o fim passa a ser o inicio */
+		}
+	}else if(TCB[tarefa].fila_espera != NULL)
+	{
+		ListaRemove(TCB[tarefa].fila_espera, tarefa);
+		TCB[tarefa].prioridade = prioridade;
+		ListaInserePorPrioridade(TCB[tarefa].fila_espera, tarefa);
+	}else
+	{
+		TCB[tarefa].prioridade = prioridade;
+	}
+}
+
+/* prioridade que a tarefa deve ter: a maior entre a sua prioridade base, o
+   teto dos mutexes com teto que ela detem e a das tarefas que esperam pelos
+   mutexes que ela detem */
+static prioridade_t PrioridadeHerdada(id_tarefa_t tarefa)
+{
+	prioridade_t prioridade = TCB[tarefa].prioridade_base;
+	mutex_t *mutex;
+	
+	if(TCB[tarefa].prioridade_teto > prioridade)
+	{
+		prioridade = TCB[tarefa].prioridade_teto;
+	}
+	
+	for(mutex = TCB[tarefa].mutexes; mutex != NULL; mutex = mutex->proximo)
+	{
+		/* a primeira tarefa da fila de espera eh a de maior prioridade */
+		if(mutex->fila_espera != 0 && TCB[mutex->fila_espera].prioridade > prioridade)
+		{
+			prioridade = TCB[mutex->fila_espera].prioridade;
+		}
+	}
+	
+	return prioridade;
+}
+
+/* recalcula a prioridade do dono de um mutex e, se ela mudou e o dono tambem
+   espera por um mutex, a do dono deste, e assim por diante (heranca 
+   transitiva) */
+static void AtualizaHeranca(id_tarefa_t dono)
+{
+	prioridade_t prioridade;
+	
+	while(dono != 0)
+	{
+		prioridade = PrioridadeHerdada(dono);
+		if(prioridade == TCB[dono].prioridade)
+		{
+			return;
+		}
+		MudaPrioridade(dono, prioridade);
+		dono = (TCB[dono].mutex_esperado != NULL) ? TCB[dono].mutex_esperado->dono : 0;
+	}
+}
+
+static void MutexColocaNoDono(mutex_t *mutex, id_tarefa_t dono)
+{
+	mutex->dono = dono;
+	mutex->recursoes = 1;
+	mutex->proximo = TCB[dono].mutexes;
+	TCB[dono].mutexes = mutex;
+}
+
+static void MutexRetiraDoDono(mutex_t *mutex)
+{
+	mutex_t **ptr = &TCB[mutex->dono].mutexes;
+	
+	while(*ptr != mutex)
+	{
+		ptr = &(*ptr)->proximo;
+	}
+	*ptr = mutex->proximo;
+	mutex->proximo = NULL;
+	mutex->dono = 0;
+}
+
+/* bloqueia a tarefa atual na fila de espera de um semaforo (se fila != NULL) e,
+   se o tempo maximo nao eh infinito, tambem na lista temporizada; o que acontecer
+   primeiro acorda a tarefa e a retira da outra espera. Deve ser chamada com as
+   interrupcoes desabilitadas e so retorna quando a tarefa for acordada, com o
+   resultado da espera */
+static resultado_t BloqueiaTarefaAtual(id_tarefa_t *fila, tick_t tempo_maximo)
+{
+	RetiraDaFilaDeProntas(tarefa_atual);
+	
+	if(fila != NULL)
+	{
+		ListaInserePorPrioridade(fila, tarefa_atual);
+		TCB[tarefa_atual].fila_espera = fila;
+		
+		/* se a espera eh por um mutex, o dono herda a prioridade da tarefa */
+		if(TCB[tarefa_atual].mutex_esperado != NULL)
+		{
+			AtualizaHeranca(TCB[tarefa_atual].mutex_esperado->dono);
+		}
+	}
+	
+	if(tempo_maximo != ESPERA_INFINITA)
+	{
+		InsereNaListaTemporizada(tarefa_atual, tempo_maximo);
+	}
+	
+	TCB[tarefa_atual].resultado = SUCESSO;
+	TROCA_CONTEXTO();		/* solicita troca de contexto, so retorna quando a tarefa ficar pronta novamente */
+	
+	return TCB[tarefa_atual].resultado;
+}
+
+/* retira a tarefa da espera em que estiver (fila de semaforo ou lista 
+   temporizada) */
+static void RetiraDasEsperas(id_tarefa_t tarefa)
+{
+	if(TCB[tarefa].fila_espera != NULL)
+	{
+		ListaRemove(TCB[tarefa].fila_espera, tarefa);
+		TCB[tarefa].fila_espera = NULL;
+	}
+	if(TCB[tarefa].mutex_esperado != NULL)
+	{
+		/* o dono do mutex pode ter herdado a prioridade desta tarefa */
+		AtualizaHeranca(TCB[tarefa].mutex_esperado->dono);
+		TCB[tarefa].mutex_esperado = NULL;
+	}
+	RetiraDaListaTemporizada(tarefa);
+}
+
+/* retira a tarefa da espera em que estiver e a coloca na fila de prontas */
+static void DesbloqueiaTarefa(id_tarefa_t tarefa)
+{
+#if cfg_MEDE_TEMPO_TAREFAS
+	if(TCB[tarefa].estado != PRONTA)
+	{
+		TCB[tarefa].despertares++;
+	}
+#endif
+	RetiraDasEsperas(tarefa);
+	ColocaNaFilaDeProntas(tarefa);
+}
+
+/* o tempo de espera da tarefa terminou: se ela esperava tambem por um 
+   semaforo, a espera termina com tempo esgotado */
+static void TerminaEsperaPorTempo(id_tarefa_t tarefa)
+{
+	if(TCB[tarefa].fila_espera != NULL)
+	{
+		TCB[tarefa].resultado = TEMPO_ESGOTADO;
+	}
+	DesbloqueiaTarefa(tarefa);		/* coloca a tarefa na fila de prontas para executar */
+}
 
 /* codigo independente de hardware */
 /* funcao para realizar o escalonamento de tarefas por prioridades 
    que retorna a proxima tarefa que sera executada, isto e, aquela que
    tem a maior prioridade e que esta pronta para executar */
    
-uint8_t escalonador(void)
-{
-    
-	uint8_t prioridade;
-	uint8_t tarefa_selecionada = 0;
-    
-	/* comeca pela maior prioridade ate encontrar 
-	uma tarefa em estado de pronta para executar  */	
-    for (prioridade=PRIORIDADE_MAXIMA;prioridade>0;prioridade--)
-	{ 
-      if(Prioridades[prioridade] != 0)
-	  {        
-        tarefa_selecionada = Prioridades[prioridade];
-        if(TCB[tarefa_selecionada].estado == PRONTA)
-		{    
-		 /* retorna aquela que tem a maior prioridade e que esta pronta para executar */		
-          return tarefa_selecionada;    
-        }
-      }
-    } 
-    
-	/* caso nenhuma esteja pronta para executar, retorna a de menor prioridade, 
-	 a qual sempre deve estar pronta para executar */
-    if(prioridade == 0) 
-	{
-    	tarefa_selecionada = Prioridades[prioridade];
-    }
-	
-	return tarefa_selecionada;
+id_tarefa_t escalonador(void)
+{
+	/* a maior prioridade com tarefa pronta eh obtida do mapa de bits em tempo
+	   constante, independente do numero de prioridades, e a tarefa escolhida eh
+	   a primeira da fila desta prioridade. Caso nenhuma esteja pronta para 
+	   executar, retorna a de menor prioridade, a qual sempre deve estar 
+	   pronta para executar */
+	return Prioridades[MaiorPrioridadePronta()];
+}
+ 
+
+
+#if cfg_VERIFICA_PILHA
+/* preenche a pilha com o padrao, de inicio (inclusive) ate fim (exclusive) */
+static void PintaPilha(stackptr_t inicio, stackptr_t fim)
+{
+	while(inicio < fim)
+	{
+		*inicio++ = PADRAO_PILHA;
+	}
+}
+#endif
+
+/* preenche o TCB da tarefa e a coloca na fila de prontas */
+static void IniciaTCB(id_tarefa_t tarefa, tarefa_t p, const char * nome,
+stackptr_t pilha, uint16_t tamanho, prioridade_t prioridade)
+{
+#if cfg_VERIFICA_PILHA
+	PintaPilha(pilha, pilha + tamanho);
+	TCB[tarefa].pilha_inicio = pilha;
+	TCB[tarefa].tamanho_pilha = tamanho;
+#endif
+	
+	pilha = CriaContexto(p, pilha + tamanho, tamanho);
+	
+	/* guardar os dados no bloco de controle da tarefa (TCB) */
+	TCB[tarefa].nome = nome;
+	TCB[tarefa].stack_pointer = (stackptr_t)(pilha);
+	TCB[tarefa].pilha_dinamica = NULL;
+	TCB[tarefa].estado = ESPERA;
+	TCB[tarefa].prioridade = prioridade;
+	TCB[tarefa].prioridade_base = prioridade;
+	TCB[tarefa].prioridade_teto = 0;
+#if cfg_MODO_PREEMPTIVO && cfg_QUANTUM_MARCAS > 0
+	TCB[tarefa].fatia_restante = cfg_QUANTUM_MARCAS;
+#endif
+	TCB[tarefa].tempo_espera = 0;
+	TCB[tarefa].fila_espera = NULL;
+	TCB[tarefa].mutex_esperado = NULL;
+	TCB[tarefa].mutexes = NULL;
+#if cfg_MEDE_TEMPO_TAREFAS
+	TCB[tarefa].ciclos_execucao = 0;
+	TCB[tarefa].ciclos_janela = 0;
+	TCB[tarefa].trocas = 0;
+	TCB[tarefa].preempcoes = 0;
+	TCB[tarefa].despertares = 0;
+	TCB[tarefa].uso_cpu = 0;
+#endif
+#if cfg_TRACO > 0 || cfg_PERFIL > 0
+	CopiaNomeTarefa(tarefa);
+#endif
+	  
+	/* colocar a tarefa (TCB) na fila de prontas da sua prioridade; varias 
+	   tarefas podem ter a mesma prioridade */
+	ColocaNaFilaDeProntas(tarefa);
+}
+
+/*********************************************/
+void CriaTarefa(tarefa_t p, const char * nome,
+stackptr_t pilha, uint16_t tamanho, prioridade_t prioridade)
+{
+	
+	if(tamanho < TAM_MINIMO_PILHA || numero_tarefas >= NUMERO_DE_TAREFAS ||
+		prioridade > PRIORIDADE_MAXIMA)
+	{
+		return;		/* pilha pequena demais, TCB[] cheio ou prioridade invalida */
+	}
+	
+	/* incrementa o numero de tarefas instaladas */
+	numero_tarefas++;
+
+	IniciaTCB(numero_tarefas, p, nome, pilha, tamanho, prioridade);
+}
+
+#if cfg_PILHAS_DINAMICAS > 0
+/* cria uma tarefa em tempo de execucao, com uma pilha do conjunto de pilhas
+   dinamicas e um TCB livre (de uma tarefa terminada ou ainda nao usado). 
+   Retorna o identificador da tarefa ou 0 se a prioridade eh invalida ou se 
+   nao ha pilha ou TCB livre */
+id_tarefa_t TarefaCria(tarefa_t p, const char * nome, prioridade_t prioridade)
+{
+	stackptr_t pilha;
+	id_tarefa_t tarefa;
+	
+	/* a prioridade indexa Prioridades[] e o mapa de prontas */
+	if(prioridade > PRIORIDADE_MAXIMA)
+	{
+		return 0;
+	}
+	
+	REG_ATOMICA_INICIO();
+	if(!pool_pilhas_iniciado)
+	{
+		PoolCria(&pool_pilhas, area_pilhas, cfg_TAM_PILHA_DINAMICA * sizeof(uint32_t), cfg_PILHAS_DINAMICAS);
+		pool_pilhas_iniciado = 1;
+	}
+	REG_ATOMICA_FIM();
+	
+	pilha = (stackptr_t)PoolAloca(&pool_pilhas, 0);
+	if(pilha == NULL)
+	{
+		return 0;
+	}
+	
+	REG_ATOMICA_INICIO();
+	
+	for(tarefa = 1; tarefa <= numero_tarefas; tarefa++)
+	{
+		if(TCB[tarefa].estado == LIVRE)
+		{
+			break;
+		}
+	}
+	if(tarefa > numero_tarefas)
+	{
+		if(numero_tarefas >= NUMERO_DE_TAREFAS)
+		{
+			REG_ATOMICA_FIM();
+			PoolLibera(&pool_pilhas, pilha);
+			return 0;
+		}
+		numero_tarefas++;
+	}
+	
+	IniciaTCB(tarefa, p, nome, pilha, cfg_TAM_PILHA_DINAMICA, prioridade);
+	TCB[tarefa].pilha_dinamica = pilha;
+	
+	/* depois de iniciado o sistema, a nova tarefa pode preemptar a atual */
+	if(tarefa_atual != 0 && prioridade > TCB[tarefa_atual].prioridade)
+	{
+		TROCA_CONTEXTO();
+	}
+	
+	REG_ATOMICA_FIM();
+	
+	return tarefa;
+}
+#endif
+
+/* a tarefa existe, nao terminou e nao eh a tarefa ociosa, que deve estar 
+   sempre pronta: so estas podem ser suspensas, continuadas ou terminadas. 
+   Chamada com as interrupcoes desabilitadas */
+static uint8_t TarefaControlavel(id_tarefa_t id_tarefa)
+{
+	return (uint8_t)(id_tarefa != 0 && id_tarefa <= numero_tarefas && TCB[id_tarefa].prioridade_base != 0 &&
+		TCB[id_tarefa].estado != TERMINADA && TCB[id_tarefa].estado != LIVRE);
+}
+
+/* termina a tarefa (pode ser a atual), retirando-a de qualquer fila. O TCB e a
+   pilha, se for dinamica, sao liberados depois pela tarefa ociosa, pois a 
+   tarefa atual ainda usa a pilha ate a troca de contexto. Retorna NAO_PERMITIDO
+   para a tarefa ociosa, para uma tarefa que ja terminou e para uma tarefa que 
+   detem mutexes, que ficariam sem dono */
+resultado_t TarefaTermina(id_tarefa_t id_tarefa)
+{
+	REG_ATOMICA_INICIO();
+	
+	if(!TarefaControlavel(id_tarefa) || TCB[id_tarefa].mutexes != NULL || TCB[id_tarefa].prioridade_teto != 0)
+	{
+		REG_ATOMICA_FIM();
+		return NAO_PERMITIDO;
+	}
+	
+	RetiraDasEsperas(id_tarefa);
+	RetiraDaFilaDeProntas(id_tarefa);
+	
+	TCB[id_tarefa].estado = TERMINADA;
+	TCB[id_tarefa].proxima = lista_terminadas;
+	lista_terminadas = id_tarefa;
+	
+	if(id_tarefa == tarefa_atual)
+	{
+		TROCA_CONTEXTO();		/* nao retorna */
+	}
+	
+	REG_ATOMICA_FIM();
+	
+	return SUCESSO;
+}
+
+/* endereco de retorno (LR) do contexto inicial: a tarefa cuja funcao retorna
+   termina normalmente */
+void FimDeTarefa(void)
+{
+	if(TarefaTermina(tarefa_atual) != SUCESSO)
+	{
+		/* a tarefa retornou detendo um mutex: fica suspensa para sempre, sem
+		   liberar o recurso, mas sem ocupar o processador */
+		TarefaSuspende(tarefa_atual);
+	}
+	for(;;)
+	{
+		/* nao chega aqui */
+	}
+}
+
+#if cfg_VERIFICA_PILHA
+/* retorna quantas palavras da pilha da tarefa nunca foram usadas, isto e, 
+   ainda tem o padrao; a pilha pode ser reduzida com seguranca ate perto disso */
+uint16_t TarefaPilhaLivre(id_tarefa_t id_tarefa)
+{
+	stackptr_t palavra = TCB[id_tarefa].pilha_inicio;
+	stackptr_t fim = palavra + TCB[id_tarefa].tamanho_pilha;
+	
+	while(palavra < fim && *palavra == PADRAO_PILHA)
+	{
+		palavra++;
+	}
+	
+	return (uint16_t)(palavra - TCB[id_tarefa].pilha_inicio);
+}
+
+/* chamada na troca de contexto quando a pilha da tarefa estourou. A memoria
+   vizinha ja pode estar corrompida, entao por padrao o sistema para aqui, com
+   a tarefa identificada, para o depurador. A aplicacao pode redefinir a funcao
+   (por exemplo, para reiniciar o processador) */
+__attribute__((weak)) void EstouroDePilha(id_tarefa_t id_tarefa)
+{
+	(void)id_tarefa;
+	REG_ATOMICA_INICIO();
+	for(;;)
+	{
+	}
+}
+#endif
+
+/* chamada pela tarefa ociosa: libera os TCBs e as pilhas das tarefas terminadas */
+static void LiberaTarefasTerminadas(void)
+{
+	id_tarefa_t tarefa;
+	stackptr_t pilha;
+	
+	while(lista_terminadas != 0)
+	{
+		REG_ATOMICA_INICIO();
+		tarefa = lista_terminadas;
+		lista_terminadas = TCB[tarefa].proxima;
+		pilha = TCB[tarefa].pilha_dinamica;
+		TCB[tarefa].pilha_dinamica = NULL;
+		TCB[tarefa].proxima = 0;
+		TCB[tarefa].estado = LIVRE;
+		REG_ATOMICA_FIM();
+		
+#if cfg_PILHAS_DINAMICAS > 0
+		if(pilha != NULL)
+		{
+			PoolLibera(&pool_pilhas, pilha);
+		}
+#else
+		(void)pilha;
+#endif
+	}
+}
+
+
+
+/* Servicos do gerenciador de tarefas */
+
+/* retira a tarefa da fila de prontas ate TarefaContinua. Retorna NAO_PERMITIDO 
+   para a tarefa ociosa e para uma tarefa que ja terminou */
+resultado_t TarefaSuspende(id_tarefa_t id_tarefa)
+{
+	REG_ATOMICA_INICIO();
+	if(!TarefaControlavel(id_tarefa))
+	{
+		REG_ATOMICA_FIM();
+		return NAO_PERMITIDO;
+	}
+	RetiraDaFilaDeProntas(id_tarefa); /* tarefa colocada em espera */
+	TrocaContexto(); 		   		/* tarefa atual solicita troca de contexto */
+	REG_ATOMICA_FIM();
+	
+	return SUCESSO;
+}
+
+/* coloca a tarefa na fila de prontas, interrompendo qualquer espera. Retorna
+   NAO_PERMITIDO para a tarefa ociosa e para uma tarefa que ja terminou, cujo 
+   TCB e pilha podem ja ter sido liberados */
+resultado_t TarefaContinua(id_tarefa_t id_tarefa)
+{
+	REG_ATOMICA_INICIO();
+	if(!TarefaControlavel(id_tarefa))
+	{
+		REG_ATOMICA_FIM();
+		return NAO_PERMITIDO;
+	}
+	if(TCB[id_tarefa].fila_espera != NULL)
+	{
+		TCB[id_tarefa].resultado = ESPERA_INTERROMPIDA;	/* nao obteve o semaforo ou mutex */
+	}
+	DesbloqueiaTarefa(id_tarefa);			/* tarefa colocada na fila de prontas, cancelando qualquer espera */
+	TrocaContexto(); 		   				/* tarefa atual solicita troca de contexto */
+	REG_ATOMICA_FIM();
+	
+	return SUCESSO;
+}
+
+void TarefaEspera(tick_t qtas_marcas)
+{
+	if(qtas_marcas > 0)  //** so valores maiores que 0 */
+	{
+		REG_ATOMICA_INICIO();			/* bloqueia interrupcoes */
+		InsereNaListaTemporizada(tarefa_atual, qtas_marcas);	/* tarefa colocada na lista temporizada */
+		RetiraDaFilaDeProntas(tarefa_atual);			/* tarefa colocada na fila de espera */
+		TrocaContexto(); 	 /* tarefa atual solicita troca de contexto, so retorna quando ficar pronta novamente */
+		REG_ATOMICA_FIM();   /* desbloqueia interrupcoes */
+	}
+}
+
+/* coloca a tarefa atual em espera ate o instante *ultimo_despertar + periodo
+   e atualiza *ultimo_despertar para esse instante. Como o instante de despertar 
+   nao depende de quando a tarefa chamou a funcao, tarefas periodicas nao 
+   acumulam atraso. As contas sao feitas em aritmetica modular, corretas mesmo
+   quando o contador de marcas de tempo da a volta. Se o instante ja passou, 
+   a tarefa continua executando */
+void TarefaEsperaAte(tick_t *ultimo_despertar, tick_t periodo)
+{
+	tick_t decorrido;
+	
+	REG_ATOMICA_INICIO();
+	
+	decorrido = contador_marcas - *ultimo_despertar;
+	*ultimo_despertar += periodo;
+	
+	if(decorrido < periodo)
+	{
+		InsereNaListaTemporizada(tarefa_atual, periodo - decorrido);	/* tarefa colocada na lista temporizada */
+		RetiraDaFilaDeProntas(tarefa_atual);							/* tarefa colocada na fila de espera */
+		TrocaContexto(); 	 /* so retorna quando ficar pronta novamente */
+	}
+	
+	REG_ATOMICA_FIM();
+}
+
+/* retorna o numero de marcas de tempo desde o inicio do sistema, somado a
+   cfg_MARCA_TEMPO_INICIAL */
+tick_t ObtemMarcaDeTempo(void)
+{
+	tick_t marcas;
+	
+	REG_ATOMICA_INICIO();		/* leitura atomica tambem com 64 bits */
+	marcas = contador_marcas;
+	REG_ATOMICA_FIM();
+	
+	return marcas;
+}
+
+#if cfg_MODO_SEM_MARCA_TEMPO
+/* chamada pela tarefa ociosa com as interrupcoes desabilitadas: se nenhuma outra 
+   tarefa esta pronta, dorme com a marca de tempo desligada ate o despertar da
+   primeira tarefa da lista temporizada (ou pelo maior tempo possivel, se a lista
+   esta vazia) e depois corrige o contador de marcas de tempo */
+static void OciosaDorme(void)
+{
+	tick_t qtas_marcas;
+	
+	if(Prioridades[MaiorPrioridadePronta()] != tarefa_atual || TCB[tarefa_atual].proxima != tarefa_atual)
+	{
+		return;		/* ha outra tarefa pronta para executar */
+	}
+	
+	qtas_marcas = (lista_temporizada != 0) ? TCB[lista_temporizada].tempo_espera : (tick_t)(~(tick_t)0);
+	
+	if(qtas_marcas >= cfg_MIN_MARCAS_OCIOSAS)
+	{
+		CompensaMarcasDeTempo(DormeMarcasDeTempo(qtas_marcas));
+	}
+}
+#endif
+
+/* Exemplo de tarefa ociosa */
+void tarefa_ociosa(void)
+{
+	
+	for(;;)
+	{		
+		LiberaTarefasTerminadas();		/* devolve as pilhas das tarefas terminadas */
+		
+		#if 1
+			REG_ATOMICA_INICIO();
+			#if cfg_MODO_SEM_MARCA_TEMPO
+			OciosaDorme();					/* dorme ate o proximo despertar */
+			#endif
+			TrocaContexto();				/* tarefa atual solicita troca de contexto */
+			REG_ATOMICA_FIM();
+		#endif
+	}
+}
+
+
+#if cfg_MODO_PREEMPTIVO
+/* liga (1) ou desliga (0) o modo preemptivo; desligado, as trocas de contexto
+   acontecem somente quando a tarefa atual bloqueia ou cede o processador */
+void ConfiguraModoPreemptivo(uint8_t habilitado)
+{
+	modo_preemptivo = habilitado;
+}
+#endif
+
+#if cfg_MEDE_TEMPO_TAREFAS || cfg_TRACO > 0
+/* contador de ciclos de clock que nao para: marcas de tempo vezes ciclos por 
+   marca mais os ciclos desde a ultima marca. Volta a zero depois de 2^32 ciclos
+   (cerca de 89 s a 48 MHz), entao so diferencas entre leituras proximas tem 
+   sentido. Deve ser chamada com as interrupcoes desabilitadas ou de dentro do
+   sistema (troca de contexto ou marca de tempo) */
+uint32_t LeContadorDeCiclos(void)
+{
+	uint32_t marcas = (uint32_t)contador_marcas;
+	uint32_t ciclos = CICLOS_DESDE_MARCA();
+	
+	if(MARCA_TEMPO_PENDENTE())
+	{
+		/* o contador voltou a LOAD e a marca ainda nao foi contada; le de novo
+		   porque a primeira leitura pode ter sido antes da volta */
+		ciclos = CICLOS_DESDE_MARCA();
+		marcas++;
+	}
+	
+	return marcas * CICLOS_POR_MARCA() + ciclos;
+}
+#endif
+
+#if cfg_MEDE_TEMPO_TAREFAS
+
+/* soma a tarefa atual os ciclos desde que ela entrou em execucao */
+static void ContaTempoExecucao(void)
+{
+	uint32_t agora = LeContadorDeCiclos();
+	
+	TCB[tarefa_atual].ciclos_execucao += agora - inicio_execucao;
+	inicio_execucao = agora;
+}
+
+/* fim da janela de medicao: o uso da CPU de cada tarefa eh a fracao da janela
+   que ela passou em execucao */
+static void AtualizaUsoCPU(void)
+{
+	id_tarefa_t tarefa;
+	uint32_t centesimo;
+	uint32_t ciclos;
+	
+	ContaTempoExecucao();
+	
+	/* a divisao por um centesimo da janela evita o estouro de ciclos * 100 */
+	centesimo = (inicio_execucao - inicio_janela) / 100;
+	inicio_janela = inicio_execucao;
+	
+	for(tarefa = 1; tarefa <= NUMERO_DE_TAREFAS; tarefa++)
+	{
+		ciclos = TCB[tarefa].ciclos_execucao - TCB[tarefa].ciclos_janela;
+		TCB[tarefa].ciclos_janela = TCB[tarefa].ciclos_execucao;
+		ciclos = (centesimo != 0) ? ciclos / centesimo : 0;
+		TCB[tarefa].uso_cpu = (ciclos > 100) ? 100 : (uint8_t)ciclos;
+	}
+}
+
+/* conta as marcas de tempo da janela de medicao do uso da CPU */
+static void AvancaJanelaUsoCPU(tick_t qtas_marcas)
+{
+	if(qtas_marcas < marcas_janela)
+	{
+		marcas_janela -= qtas_marcas;
+		return;
+	}
+	
+	marcas_janela = cfg_JANELA_USO_CPU;
+	AtualizaUsoCPU();
+}
+
+/* retorna o uso da CPU pela tarefa, em %, na ultima janela de 
+   cfg_JANELA_USO_CPU marcas de tempo */
+uint8_t TarefaUsoCPU(id_tarefa_t id_tarefa)
+{
+	return TCB[id_tarefa].uso_cpu;
+}
+#endif
+
+#if cfg_TRACO > 0
+/* registra no traco uma marca do usuario, por exemplo o inicio e o fim de um
+   trecho cuja duracao se quer ver na linha do tempo */
+void TracoMarca(uint16_t marca)
+{
+	REG_ATOMICA_INICIO();
+	TRACO(TRACO_USUARIO, tarefa_atual, marca);
+	REG_ATOMICA_FIM();
+}
+
+/* mede o custo de um registro no traco, em ciclos de clock, e o guarda no 
+   cabecalho do traco. Os registros da medicao sao descartados */
+uint32_t TracoMedeCusto(void)
+{
+	uint32_t indice;
+	uint32_t inicio;
+	uint8_t i;
+	
+	REG_ATOMICA_INICIO();
+	indice = traco.indice;
+	inicio = LeContadorDeCiclos();
+	for(i = 0; i < 16; i++)
+	{
+		TRACO(TRACO_USUARIO, tarefa_atual, i);
+	}
+	traco.ciclos_por_evento = (LeContadorDeCiclos() - inicio) / 16;
+	traco.indice = indice;
+	REG_ATOMICA_FIM();
+	
+	return traco.ciclos_por_evento;
+}
+#endif
+
+void IniciaMultitarefas(void)
+{
+#if cfg_TABELA_ESTATICA_TAREFAS
+	id_tarefa_t tarefa;
+	
+	/* so falta escrever o contexto inicial nas pilhas e montar as filas de 
+	   prontas */
+	for(tarefa = 1; tarefa <= NUMERO_TAREFAS_TABELA; tarefa++)
+	{
+#if cfg_VERIFICA_PILHA
+		PintaPilha(TCB[tarefa].pilha_inicio, TCB[tarefa].stack_pointer);
+#endif
+		CONTEXTO_INICIAL(TCB[tarefa].stack_pointer, funcoes_tarefas[tarefa], tamanhos_pilhas[tarefa]);
+#if cfg_TRACO > 0 || cfg_PERFIL > 0
+		CopiaNomeTarefa(tarefa);
+#endif
+		ColocaNaFilaDeProntas(tarefa);
+	}
+#endif
+	
+	tarefa_atual = escalonador();
+	ponteiro_de_pilha = TCB[tarefa_atual].stack_pointer;
+	SP = ponteiro_de_pilha;
+#if cfg_MEDE_TEMPO_TAREFAS
+	inicio_execucao = LeContadorDeCiclos();
+	inicio_janela = inicio_execucao;
+	TCB[tarefa_atual].trocas++;
+#endif
+	TRACO(TRACO_TROCA, tarefa_atual, 0);
+	GERA_INTERRUPCAO_SW();
+}
+
+/* escolhe a proxima tarefa; chamada pelo PendSV com as interrupcoes desabilitadas */
+void TrocaContextoDasTarefas(void)
+{
+	
+	/* guarda o valor antigo do stack pointer */
+	TCB[tarefa_atual].stack_pointer = SP;
+	
+#if cfg_VERIFICA_PILHA
+	/* o contexto salvo passou do inicio da pilha ou alterou a palavra de guarda */
+	if(SP <= TCB[tarefa_atual].pilha_inicio || *TCB[tarefa_atual].pilha_inicio != PADRAO_PILHA)
+	{
+		EstouroDePilha(tarefa_atual);
+	}
+#endif
+
+#if cfg_MEDE_TEMPO_TAREFAS
+	ContaTempoExecucao();
+#endif
+	
+	/* se a tarefa atual continua pronta e nao ha tarefa de maior prioridade 
+	   pronta, ela cede a vez e vai para o fim da fila da sua prioridade 
+	   (round-robin entre tarefas de mesma prioridade). Se foi preemptada por 
+	   uma tarefa de maior prioridade, mantem o seu lugar na fila */
+	if(Prioridades[TCB[tarefa_atual].prioridade] == tarefa_atual && 
+		MaiorPrioridadePronta() == TCB[tarefa_atual].prioridade)
+	{
+		Prioridades[TCB[tarefa_atual].prioridade] = TCB[tarefa_atual].proxima;
+#if cfg_MODO_PREEMPTIVO && cfg_QUANTUM_MARCAS > 0
+		TCB[tarefa_atual].fatia_restante = cfg_QUANTUM_MARCAS;
+#endif
+	}
+#if cfg_MODO_PREEMPTIVO && cfg_QUANTUM_MARCAS > 0
+	else if(TCB[tarefa_atual].estado != PRONTA)
+	{
+		/* a tarefa bloqueou antes do fim da fatia e volta com uma fatia 
+		   inteira. A preemptada por uma tarefa de maior prioridade guarda o 
+		   que resta da sua, para nao ganhar uma fatia nova a cada preempcao */
+		TCB[tarefa_atual].fatia_restante = cfg_QUANTUM_MARCAS;
+	}
+#endif
+		
+	/* executa o escalonador */
+	proxima_tarefa = escalonador();
+	
+#if cfg_MEDE_TEMPO_TAREFAS || cfg_TRACO > 0
+	if(proxima_tarefa != tarefa_atual)
+	{
+		TRACO(TRACO_TROCA, proxima_tarefa, tarefa_atual);
+#if cfg_MEDE_TEMPO_TAREFAS
+		TCB[proxima_tarefa].trocas++;
+		if(TCB[tarefa_atual].estado == PRONTA)
+		{
+			TCB[tarefa_atual].preempcoes++;
+		}
+#endif
+	}
+#endif
+		
+	/* seleciona a nova tarefa */
+	tarefa_atual = proxima_tarefa;
+	
+	/* coloca um novo valor no stack pointer */
+	ponteiro_de_pilha = TCB[tarefa_atual].stack_pointer;
+		
+	SP = ponteiro_de_pilha;
+
+}
+/* executa a marca de tempo e retorna 1 se alguma tarefa de maior prioridade
+   que a tarefa atual ficou pronta, isto e, se a troca de contexto eh necessaria 
+   no modo preemptivo. Deve ser chamada com as interrupcoes desabilitadas, pois
+   as interrupcoes de perifericos tambem alteram as listas do nucleo */
+uint8_t ExecutaMarcaDeTempo(void)
+{
+	
+	id_tarefa_t tarefa = 0;
+	uint8_t preempcao = 0;
+		
+	++contador_marcas; /* incrementa contador de marcas de tempo */
+	TRACO(TRACO_MARCA, tarefa_atual, contador_marcas);
+	
+#if cfg_MEDE_TEMPO_TAREFAS
+	AvancaJanelaUsoCPU(1);
+#endif
+	
+	if(lista_temporizada != 0)
+	{
+		/* somente a primeira tarefa da lista temporizada eh decrementada */
+		if(TCB[lista_temporizada].tempo_espera > 0)
+		{
+			TCB[lista_temporizada].tempo_espera--;
+		}
+		
+		/* coloca na fila de prontas todas as tarefas cujo tempo de espera 
+		 * terminou, que estao no inicio da lista com delta igual a zero */	
+		while(lista_temporizada != 0 && TCB[lista_temporizada].tempo_espera == 0)
+		{ 
+			tarefa = lista_temporizada;
+			TerminaEsperaPorTempo(tarefa);
+		}
+		
+		/* a tarefa acordada pode ter prioridade maior que a atual, ou a atual 
+		   pode ter perdido a prioridade herdada da tarefa que desistiu de um 
+		   mutex */
+		if(tarefa != 0 && MaiorPrioridadePronta() > TCB[tarefa_atual].prioridade)
+		{
+			preempcao = 1;
+		}
+	}
+	
+#if cfg_MODO_PREEMPTIVO && cfg_QUANTUM_MARCAS > 0
+	/* fatia de tempo, contada so no modo preemptivo, em que a marca de tempo
+	   pode trocar de contexto. No fim da fatia, se ha outra tarefa pronta com
+	   a mesma prioridade, pede a troca de contexto, que coloca a tarefa atual
+	   no fim da fila e renova a sua fatia. Se a troca ja foi pedida por uma 
+	   tarefa de maior prioridade, a fatia fica esgotada e a tarefa vai para o
+	   fim da fila na proxima marca de tempo em que estiver executando */
+	if(modo_preemptivo)
+	{
+		if(TCB[tarefa_atual].fatia_restante > 1)
+		{
+			TCB[tarefa_atual].fatia_restante--;
+		}else if(TCB[tarefa_atual].estado == PRONTA && TCB[tarefa_atual].proxima != tarefa_atual)
+		{
+			TCB[tarefa_atual].fatia_restante = 0;
+			if(!preempcao)
+			{
+				preempcao = 1;
+				trocas_por_fatia++;
+			}
+		}else
+		{
+			TCB[tarefa_atual].fatia_restante = cfg_QUANTUM_MARCAS;
+		}
+	}
+#endif
+	
+	return preempcao;
+}
+
+/* corrige o contador de marcas de tempo e a lista temporizada depois de um
+   periodo com a marca de tempo desligada (modo sem marca de tempo), acordando as
+   tarefas cujo tempo de espera terminou. Deve ser chamada com as interrupcoes 
+   desabilitadas */
+void CompensaMarcasDeTempo(tick_t qtas_marcas)
+{
+	id_tarefa_t tarefa;
+	
+	contador_marcas += qtas_marcas;
+	
+#if cfg_MEDE_TEMPO_TAREFAS
+	AvancaJanelaUsoCPU(qtas_marcas);
+#endif
+	
+	/* desconta as marcas dos deltas do inicio da lista temporizada */
+	while(lista_temporizada != 0 && TCB[lista_temporizada].tempo_espera <= qtas_marcas)
+	{
+		tarefa = lista_temporizada;
+		qtas_marcas -= TCB[tarefa].tempo_espera;
+		TCB[tarefa].tempo_espera = 0;
+		TerminaEsperaPorTempo(tarefa);
+	}
+	
+	if(lista_temporizada != 0)
+	{
+		TCB[lista_temporizada].tempo_espera -= qtas_marcas;
+	}
 }
- 
 
+/* Servicos de semaforos */
+void SemaforoAguarda(semaforo_t* sem)
+{
+	(void)SemaforoAguardaTempo(sem, ESPERA_INFINITA);
+}
 
-/*********************************************/
-void CriaTarefa(tarefa_t p, const char * nome,
-stackptr_t pilha, uint16_t tamanho, prioridade_t prioridade)
+/* aguarda o semaforo por no maximo tempo_maximo marcas de tempo. Retorna 
+   SUCESSO se obteve o semaforo ou TEMPO_ESGOTADO; com tempo_maximo igual a 0
+   apenas testa o semaforo, sem bloquear */
+resultado_t SemaforoAguardaTempo(semaforo_t* sem, tick_t tempo_maximo)
 {
+	resultado_t resultado = SUCESSO;
+	
+	REG_ATOMICA_INICIO();
+	TRACO(TRACO_SEMAFORO_AGUARDA, tarefa_atual, (uintptr_t)sem);
 	
-	if(tamanho < TAM_MINIMO_PILHA)
+	if(sem->contador > 0)
 	{
-		return;
+		sem->contador--;
+	}else if(tempo_maximo == 0)
+	{
+		resultado = TEMPO_ESGOTADO;
+	}else
+	{
+		/* tarefa colocada na fila de espera do semaforo e na lista temporizada */
+		resultado = BloqueiaTarefaAtual(&sem->fila_espera, tempo_maximo);
 	}
 	
-	pilha = CriaContexto(p, pilha + tamanho);
+	REG_ATOMICA_FIM();
 	
-	/* incrementa o numero de tarefas instaladas */
-	numero_tarefas++;
+	return resultado;
+}
 
-	/* guardar os dados no bloco de controle da tarefa (TCB) */
-	TCB[numero_tarefas].nome = nome;
-	TCB[numero_tarefas].stack_pointer = (stackptr_t)(pilha);
-	TCB[numero_tarefas].estado = PRONTA;
-	TCB[numero_tarefas].prioridade = prioridade;
-	TCB[numero_tarefas].tempo_espera = 0;
-	  
-	/* guardar o numero da tarefa (TCB) no vetor de prioridades das tarefas */
-	Prioridades[prioridade]=numero_tarefas;
 
+void SemaforoLibera(semaforo_t* sem)
+{
+	REG_ATOMICA_INICIO();
+	TRACO(TRACO_SEMAFORO_LIBERA, tarefa_atual, (uintptr_t)sem);
+	
+	if(sem->fila_espera != 0)
+	{	/* tem alguma tarefa aguardando ? a primeira da fila eh a de maior prioridade */
+		DesbloqueiaTarefa(sem->fila_espera);	/* tarefa retirada da espera e colocada na fila de pronta */
+	}else
+	{
+		sem->contador++;
+	}
+	TROCA_CONTEXTO();
+	
+	REG_ATOMICA_FIM();
 }
 
+/* Servicos de mutex */
+void MutexAguarda(mutex_t* mutex)
+{
+	(void)MutexAguardaTempo(mutex, ESPERA_INFINITA);
+}
 
-
-/* Servicos do gerenciador de tarefas */
-void TarefaSuspende(uint8_t id_tarefa)
+/* obtem o mutex, esperando no maximo tempo_maximo marcas de tempo. Enquanto a
+   tarefa espera, o dono do mutex executa com a prioridade dela, se for maior.
+   Retorna SUCESSO, TEMPO_ESGOTADO ou ESPERA_INTERROMPIDA; com tempo_maximo
+   igual a 0 apenas tenta obter o mutex, sem bloquear */
+resultado_t MutexAguardaTempo(mutex_t* mutex, tick_t tempo_maximo)
 {
+	resultado_t resultado = SUCESSO;
+	
 	REG_ATOMICA_INICIO();
-	TCB[id_tarefa].estado = ESPERA; /* tarefa colocada em espera */
-	TrocaContexto(); 		   		/* tarefa atual solicita troca de contexto */
+	
+	if(mutex->dono == 0)
+	{
+		MutexColocaNoDono(mutex, tarefa_atual);
+	}else if(mutex->dono == tarefa_atual)
+	{
+		mutex->recursoes++;		/* obtido de novo pelo dono */
+	}else if(tempo_maximo == 0)
+	{
+		resultado = TEMPO_ESGOTADO;
+	}else
+	{
+		/* ao ser liberado, o mutex eh passado diretamente para a primeira 
+		   tarefa da fila de espera */
+		TCB[tarefa_atual].mutex_esperado = mutex;
+		resultado = BloqueiaTarefaAtual(&mutex->fila_espera, tempo_maximo);
+	}
+	
 	REG_ATOMICA_FIM();
+	
+	return resultado;
 }
 
-void TarefaContinua(uint8_t id_tarefa)
+/* libera o mutex; somente o dono pode libera-lo (senao retorna NAO_PERMITIDO)
+   e ele so fica livre quando for liberado tantas vezes quanto foi obtido.
+   O dono volta para a prioridade que tinha antes de obter o mutex */
+resultado_t MutexLibera(mutex_t* mutex)
 {
+	id_tarefa_t proxima;
+	
 	REG_ATOMICA_INICIO();
-	TCB[id_tarefa].estado = PRONTA;			/* tarefa colocada na fila de prontas */
-	TrocaContexto(); 		   				/* tarefa atual solicita troca de contexto */
+	
+	if(mutex->dono != tarefa_atual)
+	{
+		REG_ATOMICA_FIM();
+		return NAO_PERMITIDO;
+	}
+	
+	if(--mutex->recursoes == 0)
+	{
+		MutexRetiraDoDono(mutex);
+		
+		proxima = mutex->fila_espera;
+		if(proxima != 0)
+		{	/* a tarefa de maior prioridade da fila passa a ser a dona */
+			DesbloqueiaTarefa(proxima);
+			MutexColocaNoDono(mutex, proxima);
+			AtualizaHeranca(proxima);		/* herda das tarefas que continuam esperando */
+		}
+		
+		AtualizaHeranca(tarefa_atual);		/* perde a prioridade herdada por este mutex */
+		TROCA_CONTEXTO();
+	}
+	
 	REG_ATOMICA_FIM();
+	
+	return SUCESSO;
 }
 
-void TarefaEspera(tick_t qtas_marcas)
+/* Servicos de mutex com teto de prioridade */
+
+/* obtem o mutex e eleva a prioridade da tarefa atual ao teto. Como nenhuma outra
+   tarefa que usa o recurso executa enquanto ele esta em uso, o mutex esta 
+   sempre livre (ou ja eh da tarefa atual) e a funcao nunca bloqueia. Retorna 
+   NAO_PERMITIDO se a prioridade base da tarefa eh maior que o teto ou se o 
+   mutex esta com outra tarefa (uso incorreto: o dono bloqueou com o mutex).
+   A verificacao usa a prioridade base, e nao a ja elevada por outro mutex com
+   teto, para que a tarefa possa obter varios mutexes aninhados */
+resultado_t MutexTetoObtem(mutex_teto_t* mutex)
 {
-	if(qtas_marcas > 0)  //** so valores maiores que 0 */
+	resultado_t resultado = SUCESSO;
+	
+	REG_ATOMICA_INICIO();
+	
+	if(mutex->dono == tarefa_atual)
 	{
-		REG_ATOMICA_INICIO();			/* bloqueia interrupcoes */
-		TCB[tarefa_atual].tempo_espera = qtas_marcas;	/* contador de marcas da tarefa iniciado com o valor recebido */
-		TCB[tarefa_atual].estado = ESPERA;				/* tarefa colocada na fila de espera */
-		TrocaContexto(); 	 /* tarefa atual solicita troca de contexto, so retorna quando ficar pronta novamente */
-		REG_ATOMICA_FIM();   /* desbloqueia interrupcoes */
+		mutex->recursoes++;
+	}else if(mutex->dono != 0 || TCB[tarefa_atual].prioridade_base > mutex->teto)
+	{
+		resultado = NAO_PERMITIDO;
+	}else
+	{
+		mutex->dono = tarefa_atual;
+		mutex->recursoes = 1;
+		mutex->prioridade_anterior = TCB[tarefa_atual].prioridade_teto;
+		
+		/* a prioridade nunca desce ao obter um mutex aninhado com teto menor;
+		   a efetiva pode ser maior se herdada de um mutex com heranca */
+		if(mutex->teto > TCB[tarefa_atual].prioridade_teto)
+		{
+			TCB[tarefa_atual].prioridade_teto = mutex->teto;
+		}
+		AtualizaHeranca(tarefa_atual);
 	}
+	
+	REG_ATOMICA_FIM();
+	
+	return resultado;
 }
 
-/* Exemplo de tarefa ociosa */
-void tarefa_ociosa(void)
+/* libera o mutex; a tarefa volta para a prioridade que tinha antes de obte-lo.
+   Com mutexes aninhados, a liberacao deve seguir a ordem inversa da obtencao */
+resultado_t MutexTetoLibera(mutex_teto_t* mutex)
 {
+	REG_ATOMICA_INICIO();
 	
-	for(;;)
-	{		
-		#if 1
-			REG_ATOMICA_INICIO();
-			TrocaContexto();				/* tarefa atual solicita troca de contexto */
-			REG_ATOMICA_FIM();
-		#endif
+	if(mutex->dono != tarefa_atual)
+	{
+		REG_ATOMICA_FIM();
+		return NAO_PERMITIDO;
+	}
+	
+	if(--mutex->recursoes == 0)
+	{
+		mutex->dono = 0;
+		TCB[tarefa_atual].prioridade_teto = mutex->prioridade_anterior;
+		AtualizaHeranca(tarefa_atual);
+		
+		/* so eh preciso trocar de contexto se ficou pronta alguma tarefa com
+		   prioridade maior que a restaurada */
+		if(MaiorPrioridadePronta() > TCB[tarefa_atual].prioridade)
+		{
+			TROCA_CONTEXTO();
+		}
 	}
+	
+	REG_ATOMICA_FIM();
+	
+	return SUCESSO;
 }
 
+/* Servicos de fila de mensagens */
 
-void IniciaMultitarefas(void)
+static uint8_t *FilaPosicao(fila_mensagens_t* fila, uint16_t indice)
 {
-	tarefa_atual = escalonador();
-	ponteiro_de_pilha = TCB[tarefa_atual].stack_pointer;
-	SP = ponteiro_de_pilha;
-	GERA_INTERRUPCAO_SW();
+	indice += fila->inicio;
+	if(indice >= fila->capacidade)
+	{
+		indice -= fila->capacidade;
+	}
+	return &fila->area[(uint32_t)indice * fila->tamanho_item];
 }
 
-void TrocaContextoDasTarefas(void)
+/* acorda a tarefa retirada de uma fila de espera da fila de mensagens, 
+   trocando de contexto se ela tem prioridade maior que a atual */
+static void FilaAcorda(id_tarefa_t tarefa)
+{
+	DesbloqueiaTarefa(tarefa);
+	if(TCB[tarefa].prioridade > TCB[tarefa_atual].prioridade)
+	{
+		TROCA_CONTEXTO();
+	}
+}
+
+/* envia um item (copia de tamanho_item bytes) para a fila, esperando por espaco
+   no maximo tempo_maximo marcas de tempo (0 = nao espera). Retorna SUCESSO, 
+   TEMPO_ESGOTADO ou ESPERA_INTERROMPIDA */
+resultado_t FilaEnvia(fila_mensagens_t* fila, const void* item, tick_t tempo_maximo)
 {
+	resultado_t resultado = SUCESSO;
+	id_tarefa_t tarefa;
 	
-	/* guarda o valor antigo do stack pointer */
-	TCB[tarefa_atual].stack_pointer = SP;
-		
-	/* executa o escalonador */
-	proxima_tarefa = escalonador();
-		
-	/* seleciona a nova tarefa */
-	tarefa_atual = proxima_tarefa;
-		
-	/* coloca um novo valor no stack pointer */
-	ponteiro_de_pilha = TCB[tarefa_atual].stack_pointer;
+	REG_ATOMICA_INICIO();
+	
+	if(fila->fila_recepcao != 0)
+	{	/* a fila esta vazia e ha tarefa esperando: entrega direta */
+		tarefa = fila->fila_recepcao;
+		memcpy(TCB[tarefa].dados_espera, item, fila->tamanho_item);
+		FilaAcorda(tarefa);
+	}else if(fila->quantidade < fila->capacidade)
+	{
+		memcpy(FilaPosicao(fila, fila->quantidade), item, fila->tamanho_item);
+		fila->quantidade++;
+	}else if(tempo_maximo == 0)
+	{
+		resultado = TEMPO_ESGOTADO;
+	}else
+	{
+		/* o item eh copiado pela tarefa que liberar espaco na fila */
+		TCB[tarefa_atual].dados_espera = (void *)item;
+		resultado = BloqueiaTarefaAtual(&fila->fila_envio, tempo_maximo);
+	}
+	
+	REG_ATOMICA_FIM();
+	
+	return resultado;
+}
+
+/* recebe o item mais antigo da fila, esperando no maximo tempo_maximo marcas 
+   de tempo (0 = nao espera). Retorna SUCESSO, TEMPO_ESGOTADO ou 
+   ESPERA_INTERROMPIDA */
+resultado_t FilaRecebe(fila_mensagens_t* fila, void* item, tick_t tempo_maximo)
+{
+	resultado_t resultado = SUCESSO;
+	id_tarefa_t tarefa;
+	
+	REG_ATOMICA_INICIO();
+	
+	tarefa = fila->fila_envio;
+	
+	if(fila->quantidade > 0)
+	{
+		memcpy(item, FilaPosicao(fila, 0), fila->tamanho_item);
+		fila->inicio = (fila->inicio + 1 < fila->capacidade) ? fila->inicio + 1 : 0;
+		fila->quantidade--;
 		
-	SP = ponteiro_de_pilha;
+		if(tarefa != 0)
+		{	/* a fila estava cheia: o item da primeira tarefa esperando ocupa o espaco liberado */
+			memcpy(FilaPosicao(fila, fila->quantidade), TCB[tarefa].dados_espera, fila->tamanho_item);
+			fila->quantidade++;
+			FilaAcorda(tarefa);
+		}
+	}else if(tarefa != 0)
+	{	/* fila sem area (capacidade 0): recebe diretamente da tarefa */
+		memcpy(item, TCB[tarefa].dados_espera, fila->tamanho_item);
+		FilaAcorda(tarefa);
+	}else if(tempo_maximo == 0)
+	{
+		resultado = TEMPO_ESGOTADO;
+	}else
+	{
+		/* o item eh copiado diretamente pela tarefa que enviar */
+		TCB[tarefa_atual].dados_espera = item;
+		resultado = BloqueiaTarefaAtual(&fila->fila_recepcao, tempo_maximo);
+	}
+	
+	REG_ATOMICA_FIM();
+	
+	return resultado;
+}
+
+/* modo sem copia: a fila (criada com tamanho_item = sizeof(void *)) transporta 
+   somente o ponteiro para a mensagem, que fica, por exemplo, em um conjunto
+   de buffers. O receptor passa a ser responsavel pelo buffer */
+resultado_t FilaEnviaPonteiro(fila_mensagens_t* fila, void* ponteiro, tick_t tempo_maximo)
+{
+	return FilaEnvia(fila, &ponteiro, tempo_maximo);
+}
+
+resultado_t FilaRecebePonteiro(fila_mensagens_t* fila, void** ponteiro, tick_t tempo_maximo)
+{
+	return FilaRecebe(fila, ponteiro, tempo_maximo);
+}
 
+/* Servicos de grupo de eventos */
+
+/* verifica se os eventos do grupo satisfazem a espera */
+static uint8_t EventosSatisfazem(uint32_t bits, uint32_t esperados, uint8_t opcoes)
+{
+	if(opcoes & EVENTOS_TODOS)
+	{
+		return (bits & esperados) == esperados;
+	}
+	return (bits & esperados) != 0;
 }
-void ExecutaMarcaDeTempo(void)
+
+/* sinaliza os eventos e acorda, em uma unica passagem pela fila de espera, 
+   todas as tarefas cuja espera ficou satisfeita. Os eventos das tarefas que
+   pediram EVENTOS_LIMPA sao limpos depois de todas serem verificadas, assim
+   todas veem os mesmos eventos. Pode ser chamada por interrupcoes */
+void EventosSinaliza(grupo_eventos_t* grupo, uint32_t eventos)
 {
+	id_tarefa_t tarefa, proxima, ultima;
+	uint32_t limpar = 0;
+	uint8_t troca = 0;
 	
-	uint8_t tarefa = 0;
-		
-	++contador_marcas; /* incrementa contador de marcas de tempo */
+	REG_ATOMICA_INICIO();
 	
-	/* laco para decrementar tempo de espera das tarefas 
-	 * e coloca-las na fila de prontas para executar  */	
-	for (tarefa=numero_tarefas;tarefa > 0;tarefa--)
-	{ 
-	  
-		if(TCB[tarefa].tempo_espera > 0 ) /* se esta esperando algum tempo */
-		{	
-			TCB[tarefa].tempo_espera--; /* decrementa tempo de espera */
+	grupo->bits |= eventos;
+	
+	tarefa = grupo->fila_espera;
+	if(tarefa != 0)
+	{
+		ultima = TCB[tarefa].anterior;
+		for(;;)
+		{
+			proxima = TCB[tarefa].proxima;	/* antes de retirar a tarefa da fila */
+			
+			if(EventosSatisfazem(grupo->bits, TCB[tarefa].eventos, TCB[tarefa].opcoes_eventos))
+			{
+				if(TCB[tarefa].opcoes_eventos & EVENTOS_LIMPA)
+				{
+					limpar |= TCB[tarefa].eventos;
+				}
+				TCB[tarefa].eventos = grupo->bits;
+				DesbloqueiaTarefa(tarefa);
+				
+				if(TCB[tarefa].prioridade > TCB[tarefa_atual].prioridade)
+				{
+					troca = 1;
+				}
+			}
 			
-			if(TCB[tarefa].tempo_espera == 0 )
+			if(tarefa == ultima)
 			{
-				/* coloca a tarefa na fila de prontas para executar */	
-				TCB[tarefa].estado = PRONTA;	        				
+				break;
 			}
+			tarefa = proxima;
 		}
-	 }
+	}
+	
+	grupo->bits &= ~limpar;
+	
+	if(troca)
+	{
+		TROCA_CONTEXTO();
+	}
+	
+	REG_ATOMICA_FIM();
 }
 
-/* Servicos de semaforos */
-void SemaforoAguarda(semaforo_t* sem)
+void EventosLimpa(grupo_eventos_t* grupo, uint32_t eventos)
+{
+	REG_ATOMICA_INICIO();
+	grupo->bits &= ~eventos;
+	REG_ATOMICA_FIM();
+}
+
+/* espera por qualquer um (EVENTOS_QUALQUER) ou por todos (EVENTOS_TODOS) os 
+   eventos dados, no maximo tempo_maximo marcas de tempo (0 = nao espera). Com
+   EVENTOS_LIMPA, os eventos esperados sao limpos quando a espera eh satisfeita.
+   Se obtidos != NULL, recebe os eventos do grupo no instante em que a espera 
+   terminou. Retorna SUCESSO, TEMPO_ESGOTADO ou ESPERA_INTERROMPIDA */
+resultado_t EventosAguarda(grupo_eventos_t* grupo, uint32_t eventos, uint8_t opcoes, uint32_t* obtidos, tick_t tempo_maximo)
 {
+	resultado_t resultado = SUCESSO;
+	uint32_t bits;
 	
 	REG_ATOMICA_INICIO();
 	
-	if(sem->contador > 0)
+	bits = grupo->bits;
+	
+	if(EventosSatisfazem(bits, eventos, opcoes))
 	{
-		sem->contador--;
+		if(opcoes & EVENTOS_LIMPA)
+		{
+			grupo->bits &= ~eventos;
+		}
+	}else if(tempo_maximo == 0)
+	{
+		resultado = TEMPO_ESGOTADO;
 	}else
 	{
-		TCB[tarefa_atual].estado = ESPERA;		/* tarefa colocada na fila de espera */
-		sem->tarefaEsperando = tarefa_atual;   	/* tarefa colocada na espera do semaforo */
-		TROCA_CONTEXTO();						/* solicita troca de contexto */
+		TCB[tarefa_atual].eventos = eventos;
+		TCB[tarefa_atual].opcoes_eventos = opcoes;
+		resultado = BloqueiaTarefaAtual(&grupo->fila_espera, tempo_maximo);
+		
+		/* se foi acordada por EventosSinaliza, a tarefa recebeu os eventos */
+		bits = (resultado == SUCESSO) ? TCB[tarefa_atual].eventos : grupo->bits;
 	}
 	
 	REG_ATOMICA_FIM();
+	
+	if(obtidos != NULL)
+	{
+		*obtidos = bits;
+	}
+	
+	return resultado;
 }
 
+/* Servicos de conjunto de blocos de memoria */
 
-void SemaforoLibera(semaforo_t* sem)
+/* inicializa o conjunto com numero_blocos blocos tomados da area, que deve ser
+   alinhada para ponteiros (ver POOL_MEMORIA_AREA). O tamanho do bloco eh 
+   arredondado para um multiplo do tamanho de um ponteiro */
+void PoolCria(pool_memoria_t* pool, void* area, uint16_t tamanho_bloco, uint16_t numero_blocos)
+{
+	uint8_t *bloco = (uint8_t *)area;
+	uint16_t i;
+	
+	tamanho_bloco = (uint16_t)((tamanho_bloco + sizeof(void *) - 1) & ~(sizeof(void *) - 1));
+	
+	pool->livres = (numero_blocos > 0) ? area : NULL;
+	pool->tamanho_bloco = tamanho_bloco;
+	pool->numero_blocos = numero_blocos;
+	pool->em_uso = 0;
+	pool->maximo_em_uso = 0;
+	pool->falhas = 0;
+	pool->fila_espera = 0;
+	
+	/* encadeia os blocos livres */
+	for(i = 1; i < numero_blocos; i++)
+	{
+		*(void **)bloco = bloco + tamanho_bloco;
+		bloco += tamanho_bloco;
+	}
+	if(numero_blocos > 0)
+	{
+		*(void **)bloco = NULL;
+	}
+}
+
+/* aloca um bloco, esperando no maximo tempo_maximo marcas de tempo se nao ha 
+   bloco livre (0 = nao espera, unica opcao em interrupcoes). Retorna NULL se 
+   nao conseguiu o bloco */
+void* PoolAloca(pool_memoria_t* pool, tick_t tempo_maximo)
+{
+	void *bloco = NULL;
+	
+	REG_ATOMICA_INICIO();
+	
+	if(pool->livres != NULL)
+	{
+		bloco = pool->livres;
+		pool->livres = *(void **)bloco;
+		if(++pool->em_uso > pool->maximo_em_uso)
+		{
+			pool->maximo_em_uso = pool->em_uso;
+		}
+	}else if(tempo_maximo != 0)
+	{
+		/* o bloco eh entregue diretamente pela tarefa que o liberar */
+		if(BloqueiaTarefaAtual(&pool->fila_espera, tempo_maximo) == SUCESSO)
+		{
+			bloco = TCB[tarefa_atual].dados_espera;
+		}
+	}
+	
+	if(bloco == NULL)
+	{
+		pool->falhas++;
+	}
+	
+	REG_ATOMICA_FIM();
+	
+	return bloco;
+}
+
+/* devolve o bloco ao conjunto ou, se ha tarefa esperando, entrega-o a ela. 
+   Pode ser chamada por interrupcoes */
+void PoolLibera(pool_memoria_t* pool, void* bloco)
 {
+	id_tarefa_t tarefa;
+	
 	REG_ATOMICA_INICIO();
 	
-	if(sem->tarefaEsperando > 0)
-	{	/* tem alguma tarefa aguardando ? */
-		TCB[sem->tarefaEsperando].estado = PRONTA;		/* tarefa colocada na fila de pronta */
-		sem->tarefaEsperando = 0;						/* tarefa retirada da espera do semaforo */
+	tarefa = pool->fila_espera;
+	if(tarefa != 0)
+	{	/* o bloco continua em uso, agora pela tarefa acordada */
+		TCB[tarefa].dados_espera = bloco;
+		DesbloqueiaTarefa(tarefa);
+		if(TCB[tarefa].prioridade > TCB[tarefa_atual].prioridade)
+		{
+			TROCA_CONTEXTO();
+		}
 	}else
 	{
-		sem->contador++;
+		*(void **)bloco = pool->livres;
+		pool->livres = bloco;
+		pool->em_uso--;
 	}
-	TROCA_CONTEXTO();
 	
 	REG_ATOMICA_FIM();
 }
+
+#if cfg_TAM_HEAP > 0
+/* Servicos do heap do sistema: o heap TLSF protegido por regiao atomica. Como
+   alocar e liberar tem tempo limitado, podem ser chamados por interrupcoes */
+static heap_t heap_sistema;
+static void *area_heap[cfg_TAM_HEAP / sizeof(void *)];
+static uint8_t heap_iniciado = 0;
+
+void* HeapAloca(size_t tamanho)
+{
+	void *ptr;
+	
+	REG_ATOMICA_INICIO();
+	
+	if(!heap_iniciado)
+	{
+		heap_iniciado = HeapTLSFInicia(&heap_sistema, area_heap, sizeof(area_heap));
+	}
+	ptr = HeapTLSFAloca(&heap_sistema, tamanho);
+	
+	REG_ATOMICA_FIM();
+	
+	return ptr;
+}
+
+void HeapLibera(void* ptr)
+{
+	REG_ATOMICA_INICIO();
+	HeapTLSFLibera(&heap_sistema, ptr);
+	REG_ATOMICA_FIM();
+}
+
+void HeapEstatisticas(heap_estatisticas_t* estatisticas)
+{
+	REG_ATOMICA_INICIO();
+	HeapTLSFEstatisticas(&heap_sistema, estatisticas);
+	REG_ATOMICA_FIM();
+}
+#endif
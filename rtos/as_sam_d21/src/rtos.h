@@ -9,27 +9,178 @@
 
 #include <asf.h>
 #include "stdint.h"
+#include "stddef.h"
 #include "cpu-port.h"
+#include "heap_tlsf.h"
 
 /******************************************************************/
-/* macros de configuracao */
+/* macros de configuracao; os valores abaixo sao os padroes, e cada macro pode
+   ser definida na linha de comando do compilador (-D), como fazem os 
+   benchmarks em rtos/bench */
 
-/* numero de tarefas */
+/* tabela estatica de tarefas (config/conf_tarefas.h): as tarefas, suas pilhas
+   e seus TCBs sao definidos em tempo de compilacao, e o numero de tarefas eh 
+   obtido da tabela (1 = habilitado). Desabilitado, as tarefas sao criadas com
+   CriaTarefa */
+#ifndef cfg_TABELA_ESTATICA_TAREFAS
+#define cfg_TABELA_ESTATICA_TAREFAS  0
+#endif
+
+#if cfg_TABELA_ESTATICA_TAREFAS
+#include "conf_tarefas.h"
+#define CONTA_TAREFA(funcao, nome, tamanho_pilha, prioridade)	+ 1
+/* numero de tarefas: as da tabela, a tarefa ociosa e as criadas com TarefaCria */
+#define NUMERO_DE_TAREFAS	(TABELA_TAREFAS(CONTA_TAREFA) + 1 + cfg_PILHAS_DINAMICAS)
+#else
+/* numero de tarefas, incluindo as que podem ser criadas com TarefaCria */
+#ifndef NUMERO_DE_TAREFAS
 #define NUMERO_DE_TAREFAS	3
+#endif
+#endif
 
 /* numero de prioridades/tarefas */
+#ifndef PRIORIDADE_MAXIMA
 #define PRIORIDADE_MAXIMA   4
+#endif
+
+/* o mapa de bits de tarefas prontas comporta ate 64 prioridades (0 a 63) */
+#if PRIORIDADE_MAXIMA > 63
+#error "PRIORIDADE_MAXIMA deve ser menor ou igual a 63"
+#endif
 
 /* frequencia de clock da CPU */
+#ifndef cfg_CPU_CLOCK_HZ
 #define cfg_CPU_CLOCK_HZ 	48000000
+#endif
 
 /* frequencia da marca de tempo do sistema multitarefas */
+#ifndef cfg_MARCA_TEMPO_HZ
 #define cfg_MARCA_TEMPO_HZ  1000
+#endif
+
+/* suporte ao modo preemptivo: na marca de tempo, a troca de contexto so eh 
+   solicitada quando uma tarefa de maior prioridade que a atual fica pronta. 
+   O modo pode ser ligado e desligado em tempo de execucao com 
+   ConfiguraModoPreemptivo() (1 = habilitado) */
+#ifndef cfg_MODO_PREEMPTIVO
+#define cfg_MODO_PREEMPTIVO   1
+#endif
+
+/* fatia de tempo (quantum), em marcas de tempo, de cada tarefa quando ha outras
+   tarefas prontas com a mesma prioridade. So tem efeito no modo preemptivo
+   (0 = sem fatia de tempo) */
+#ifndef cfg_QUANTUM_MARCAS
+#define cfg_QUANTUM_MARCAS    10
+#endif
+
+/* largura do contador de marcas de tempo: 0 = 32 bits (volta a zero apos
+   cerca de 49 dias a 1 kHz), 1 = 64 bits */
+#ifndef cfg_MARCA_TEMPO_64BITS
+#define cfg_MARCA_TEMPO_64BITS  0
+#endif
+
+/* valor inicial do contador de marcas de tempo. Perto do maximo, o contador 
+   da a volta logo depois da partida, para testar as contas que devem estar
+   certas na volta */
+#ifndef cfg_MARCA_TEMPO_INICIAL
+#define cfg_MARCA_TEMPO_INICIAL  0
+#endif
+
+/* mede a duracao em ciclos da rotina de marca de tempo (1 = habilitado) */
+#ifndef cfg_MEDE_MARCA_TEMPO
+#define cfg_MEDE_MARCA_TEMPO  0
+#endif
+
+/* modo sem marca de tempo periodica (tickless): quando somente a tarefa ociosa 
+   esta pronta, a marca de tempo eh reprogramada para o proximo despertar e o 
+   processador dorme (WFI) ate la (1 = habilitado) */
+#ifndef cfg_MODO_SEM_MARCA_TEMPO
+#define cfg_MODO_SEM_MARCA_TEMPO  0
+#endif
+
+/* numero minimo de marcas de tempo ociosas para que a tarefa ociosa durma */
+#ifndef cfg_MIN_MARCAS_OCIOSAS
+#define cfg_MIN_MARCAS_OCIOSAS    2
+#endif
+
+/* tamanho em bytes do heap do sistema, usado por HeapAloca/HeapLibera 
+   (0 = sem heap) */
+#ifndef cfg_TAM_HEAP
+#define cfg_TAM_HEAP          0
+#endif
+
+/* tarefas criadas em tempo de execucao (TarefaCria): numero de pilhas do 
+   conjunto de pilhas dinamicas (0 = sem TarefaCria) e tamanho de cada uma, em
+   palavras. As pilhas das tarefas terminadas sao devolvidas pela tarefa ociosa */
+#ifndef cfg_PILHAS_DINAMICAS
+#define cfg_PILHAS_DINAMICAS    0
+#endif
+#ifndef cfg_TAM_PILHA_DINAMICA
+#define cfg_TAM_PILHA_DINAMICA  (TAM_MINIMO_PILHA + 48)
+#endif
+
+/* verificacao das pilhas: as pilhas sao preenchidas com PADRAO_PILHA na criacao
+   da tarefa, o que permite medir o quanto de cada uma ja foi usado 
+   (TarefaPilhaLivre), e a cada troca de contexto a palavra mais baixa da pilha
+   da tarefa que sai (palavra de guarda) eh verificada; se foi alterada, chama
+   EstouroDePilha (1 = habilitado) */
+#ifndef cfg_VERIFICA_PILHA
+#define cfg_VERIFICA_PILHA      0
+#endif
+
+/* medicao do tempo de execucao de cada tarefa em ciclos de clock, contado a cada
+   troca de contexto, e do numero de trocas, preempcoes e despertares. O uso da
+   CPU por tarefa (TarefaUsoCPU) eh recalculado a cada cfg_JANELA_USO_CPU marcas
+   de tempo (1 = habilitado) */
+#ifndef cfg_MEDE_TEMPO_TAREFAS
+#define cfg_MEDE_TEMPO_TAREFAS  0
+#endif
+#ifndef cfg_JANELA_USO_CPU
+#define cfg_JANELA_USO_CPU      1000
+#endif
+
+/* registro de eventos do sistema (traco) em um buffer circular na RAM: trocas
+   de contexto, marcas de tempo, semaforos, mudancas de estado das tarefas e 
+   marcas do usuario (TracoMarca), com o instante em ciclos de clock. O buffer
+   (variavel traco) eh copiado pelo depurador e convertido por 
+   rtos/tools/traco.py. Numero de registros, potencia de 2 (0 = desabilitado, 
+   sem nenhum codigo de registro) */
+#ifndef cfg_TRACO
+#define cfg_TRACO               0
+#endif
+
+/* perfil estatistico: a cada marca de tempo o PC da tarefa interrompida eh
+   guardado, com o numero da tarefa, em um buffer circular na RAM (variavel 
+   perfil), que eh copiado pelo depurador e convertido em um perfil por funcao
+   e por tarefa por rtos/tools/perfil.py. Numero de amostras, potencia de 2 
+   (0 = desabilitado) */
+#ifndef cfg_PERFIL
+#define cfg_PERFIL              0
+#endif
 
 typedef  void (*tarefa_t)(void);
-typedef enum {PRONTA, ESPERA} estado_tarefa_t;
+typedef enum {PRONTA, ESPERA, TERMINADA, LIVRE} estado_tarefa_t;
 typedef uint8_t	  prioridade_t;
-typedef uint16_t  tick_t;
+#if cfg_MARCA_TEMPO_64BITS
+typedef uint64_t  tick_t;
+#else
+typedef uint32_t  tick_t;
+#endif
+/* indice da tarefa no vetor TCB (0 = nenhuma tarefa); com 255 tarefas ou mais,
+   8 bits nao bastam para o indice e para o fim dos lacos sobre as tarefas */
+#if NUMERO_DE_TAREFAS >= 255
+typedef uint16_t  id_tarefa_t;
+#else
+typedef uint8_t   id_tarefa_t;
+#endif
+
+/* resultado das esperas com tempo maximo */
+typedef enum {SUCESSO = 0, TEMPO_ESGOTADO, ESPERA_INTERROMPIDA, NAO_PERMITIDO} resultado_t;
+
+/* tempo maximo de espera que nunca se esgota */
+#define ESPERA_INFINITA		((tick_t)~(tick_t)0)
+
+typedef struct mutex mutex_t;
 
 /**
 * \struct tcb_t
@@ -40,16 +191,51 @@ typedef struct
 {
 	const char		*nome;
 	stackptr_t 	stack_pointer;
+	stackptr_t		pilha_dinamica;	///< pilha obtida do conjunto de pilhas dinamicas (NULL = nenhuma)
+#if cfg_VERIFICA_PILHA
+	stackptr_t		pilha_inicio;	///< palavra mais baixa da pilha, usada como palavra de guarda
+	uint16_t		tamanho_pilha;	///< tamanho da pilha, em palavras
+#endif
 	estado_tarefa_t estado;
-	prioridade_t 	prioridade;
-	uint16_t		tempo_espera;
+	prioridade_t 	prioridade;		///< prioridade efetiva, pode ter sido herdada por um mutex
+	prioridade_t	prioridade_base;	///< prioridade definida na criacao da tarefa
+	prioridade_t	prioridade_teto;	///< maior teto entre os mutexes com teto que a tarefa detem (0 = nenhum)
+	tick_t			tempo_espera;	///< marcas de tempo apos a tarefa anterior da lista temporizada
+#if cfg_MODO_PREEMPTIVO && cfg_QUANTUM_MARCAS > 0
+	tick_t			fatia_restante;	///< marcas de tempo que restam da fatia de tempo (0 = esgotada)
+#endif
+	id_tarefa_t		proxima;		///< proxima tarefa na fila de prontas ou de espera
+	id_tarefa_t		anterior;		///< tarefa anterior na fila de prontas ou de espera
+	id_tarefa_t		*fila_espera;	///< fila de espera de semaforo onde a tarefa esta (NULL = nenhuma)
+	resultado_t		resultado;		///< motivo pelo qual a ultima espera terminou
+	mutex_t			*mutex_esperado;	///< mutex pelo qual a tarefa espera (NULL = nenhum)
+	mutex_t			*mutexes;		///< lista dos mutexes que a tarefa detem
+	void			*dados_espera;	///< item a enviar ou destino do item a receber, na espera em uma fila de mensagens
+	uint32_t		eventos;		///< eventos esperados e, ao acordar, os eventos do grupo naquele instante
+	uint8_t			opcoes_eventos;	///< opcoes da espera por eventos (EVENTOS_*)
+	id_tarefa_t		proxima_temporizada;	///< proxima tarefa na lista temporizada
+	id_tarefa_t		anterior_temporizada;	///< tarefa anterior na lista temporizada
+#if cfg_MEDE_TEMPO_TAREFAS
+	uint32_t		ciclos_execucao;	///< ciclos de clock em execucao (volta a zero)
+	uint32_t		ciclos_janela;	///< valor de ciclos_execucao no inicio da janela atual
+	uint32_t		trocas;			///< vezes em que a tarefa entrou em execucao
+	uint32_t		preempcoes;		///< vezes em que a tarefa saiu de execucao ainda pronta
+	uint32_t		despertares;	///< vezes em que a tarefa saiu de uma espera
+	uint8_t			uso_cpu;		///< uso da CPU na ultima janela completa, em %
+#endif
 }tcb_t;
 
-extern  uint8_t		tarefa_atual;
-extern  uint8_t		proxima_tarefa;
+extern  id_tarefa_t	tarefa_atual;
+extern  id_tarefa_t	proxima_tarefa;
 extern  tcb_t		TCB[NUMERO_DE_TAREFAS+1];
 extern  stackptr_t	ponteiro_de_pilha;
-extern  prioridade_t Prioridades[PRIORIDADE_MAXIMA+1];
+extern  id_tarefa_t	Prioridades[PRIORIDADE_MAXIMA+1];
+#if cfg_MODO_PREEMPTIVO
+extern  volatile uint8_t modo_preemptivo;
+#if cfg_QUANTUM_MARCAS > 0
+extern  volatile uint32_t trocas_por_fatia;
+#endif
+#endif
 
 /**
 * \struct semaforo_t
@@ -58,25 +244,265 @@ extern  prioridade_t Prioridades[PRIORIDADE_MAXIMA+1];
 
 typedef struct 
 {
-	uint8_t     contador;            ///< Contador do semaforo
-	uint8_t 	tarefaEsperando;        ///< Tarefa esperando
+	uint16_t    contador;            ///< Contador do semaforo
+	id_tarefa_t	fila_espera;         ///< Fila de tarefas esperando, em ordem de prioridade
 } semaforo_t;
 
+/**
+* \struct mutex
+* Estrutura de controle do mutex com heranca de prioridade: enquanto uma 
+* tarefa de maior prioridade espera pelo mutex, o dono executa com a 
+* prioridade dela. Pode ser obtido varias vezes pelo mesmo dono.
+*/
+
+struct mutex
+{
+	id_tarefa_t	dono;                ///< Tarefa que detem o mutex (0 = livre)
+	uint8_t		recursoes;           ///< Numero de vezes que o dono obteve o mutex
+	id_tarefa_t	fila_espera;         ///< Fila de tarefas esperando, em ordem de prioridade
+	mutex_t		*proximo;            ///< Proximo mutex na lista de mutexes do dono
+};
+
+/**
+* \struct mutex_teto_t
+* Estrutura de controle do mutex com teto de prioridade imediato: ao obter o 
+* mutex, o dono passa a executar na prioridade teto, que deve ser a maior 
+* prioridade entre as tarefas que usam o recurso. Assim nenhuma outra delas
+* executa enquanto o recurso esta em uso e o mutex nunca precisa de fila de 
+* espera. O dono nao deve bloquear enquanto detem o mutex e, se obtiver mais
+* de um, deve libera-los na ordem inversa.
+*/
+
+typedef struct
+{
+	prioridade_t	teto;                ///< Prioridade teto do recurso
+	id_tarefa_t		dono;                ///< Tarefa que detem o mutex (0 = livre)
+	uint8_t			recursoes;           ///< Numero de vezes que o dono obteve o mutex
+	prioridade_t	prioridade_anterior; ///< prioridade_teto do dono antes de obter o mutex
+} mutex_teto_t;
+
+/**
+* \struct fila_mensagens_t
+* Estrutura de controle da fila de mensagens: itens de tamanho fixo copiados
+* para uma area circular de capacidade itens. Quando ha tarefa esperando, o 
+* item eh copiado diretamente entre as tarefas, sem passar pela area. Para 
+* nao copiar mensagens grandes, a fila pode transportar ponteiros (tamanho do
+* item igual a sizeof(void *)) com FilaEnviaPonteiro/FilaRecebePonteiro.
+*/
+
+typedef struct
+{
+	uint8_t		*area;               ///< Area de armazenamento com capacidade * tamanho_item bytes
+	uint16_t	tamanho_item;        ///< Tamanho de cada item, em bytes
+	uint16_t	capacidade;          ///< Numero maximo de itens na area
+	uint16_t	quantidade;          ///< Numero de itens na area
+	uint16_t	inicio;              ///< Posicao do item mais antigo
+	id_tarefa_t	fila_envio;          ///< Tarefas esperando espaco, em ordem de prioridade
+	id_tarefa_t	fila_recepcao;       ///< Tarefas esperando item, em ordem de prioridade
+} fila_mensagens_t;
+
+/* inicializador de uma fila de mensagens com a area de armazenamento dada */
+#define FILA_MENSAGENS_INICIALIZADOR(area, tamanho_item, capacidade) \
+	{(uint8_t *)(area), (tamanho_item), (capacidade), 0, 0, 0, 0}
+
+/**
+* \struct grupo_eventos_t
+* Estrutura de controle do grupo de eventos: 32 bits (eventos) sinalizados por
+* tarefas ou interrupcoes. Uma tarefa pode esperar por qualquer um ou por todos
+* os eventos de um conjunto.
+*/
+
+typedef struct
+{
+	volatile uint32_t	bits;        ///< Eventos sinalizados
+	id_tarefa_t			fila_espera; ///< Fila de tarefas esperando, em ordem de prioridade
+} grupo_eventos_t;
+
+/* opcoes da espera por eventos */
+#define EVENTOS_QUALQUER	0x00	///< acorda com qualquer um dos eventos
+#define EVENTOS_TODOS		0x01	///< acorda somente com todos os eventos
+#define EVENTOS_LIMPA		0x02	///< limpa os eventos esperados ao acordar
+
+/**
+* \struct pool_memoria_t
+* Estrutura de controle do conjunto (pool) de blocos de memoria de tamanho 
+* fixo. Os blocos livres formam uma lista encadeada pelo proprio bloco, assim
+* alocar e liberar tem tempo constante. Para varios tamanhos de bloco, usa-se
+* um conjunto para cada tamanho.
+*/
+
+typedef struct
+{
+	void		*livres;             ///< Primeiro bloco livre; cada bloco livre aponta para o proximo
+	uint16_t	tamanho_bloco;       ///< Tamanho de cada bloco, em bytes
+	uint16_t	numero_blocos;       ///< Numero total de blocos
+	uint16_t	em_uso;              ///< Numero de blocos alocados
+	uint16_t	maximo_em_uso;       ///< Maior numero de blocos alocados ao mesmo tempo
+	uint16_t	falhas;              ///< Numero de alocacoes que nao foram atendidas
+	id_tarefa_t	fila_espera;         ///< Fila de tarefas esperando bloco, em ordem de prioridade
+} pool_memoria_t;
+
+/* declara a area de armazenamento de um conjunto de blocos, alinhada para 
+   ponteiros */
+#define POOL_MEMORIA_AREA(nome, tamanho_bloco, numero_blocos) \
+	void *nome[(((tamanho_bloco) + sizeof(void *) - 1) / sizeof(void *)) * (numero_blocos)]
+
+#if cfg_TRACO > 0
+#if (cfg_TRACO & (cfg_TRACO - 1)) != 0
+#error "cfg_TRACO deve ser uma potencia de 2"
+#endif
+
+/* eventos do traco; o significado de tarefa e dado esta ao lado */
+typedef enum 
+{
+	TRACO_TROCA = 1,			/* tarefa: a que entra, dado: a que sai */
+	TRACO_MARCA,				/* tarefa: atual, dado: 16 bits baixos do contador de marcas */
+	TRACO_PRONTA,				/* tarefa: a que ficou pronta, dado: prioridade */
+	TRACO_BLOQUEIA,				/* tarefa: a que saiu da fila de prontas, dado: prioridade */
+	TRACO_SEMAFORO_AGUARDA,		/* tarefa: atual, dado: 16 bits baixos do endereco do semaforo */
+	TRACO_SEMAFORO_LIBERA,		/* tarefa: atual, dado: 16 bits baixos do endereco do semaforo */
+	TRACO_USUARIO				/* tarefa: atual, dado: marca passada a TracoMarca */
+} evento_traco_t;
+
+/**
+* \struct registro_traco_t
+* Registro de um evento do traco (8 bytes)
+*/
+
+typedef struct
+{
+	uint32_t	tempo;		///< Instante do evento, em ciclos de clock (LeContadorDeCiclos)
+	uint16_t	dado;		///< Dado do evento (ver evento_traco_t)
+	uint8_t		evento;		///< Tipo do evento (evento_traco_t)
+	uint8_t		tarefa;		///< Tarefa do evento (8 bits baixos do indice)
+} registro_traco_t;
+
+#define TRACO_IDENTIFICADOR		0x54524143UL	/* "TRAC" */
+#define TRACO_TAM_NOME			8
+
+/**
+* \struct traco_t
+* Buffer do traco com o cabecalho usado pelo decodificador. Quando cheio, os
+* registros mais antigos sao sobrescritos.
+*/
+
+typedef struct
+{
+	uint32_t			identificador;		///< TRACO_IDENTIFICADOR
+	uint32_t			frequencia;			///< Ciclos de clock por segundo
+	uint32_t			indice;				///< Total de registros ja escritos; o proximo vai em indice % cfg_TRACO
+	uint32_t			ciclos_por_evento;	///< Custo medido de um registro (TracoMedeCusto)
+	uint16_t			numero_registros;	///< cfg_TRACO
+	uint16_t			numero_nomes;		///< Linhas de nomes (NUMERO_DE_TAREFAS + 1)
+	char				nomes[NUMERO_DE_TAREFAS+1][TRACO_TAM_NOME];	///< Nomes das tarefas, sem terminador se ocupam TRACO_TAM_NOME
+	registro_traco_t	registros[cfg_TRACO];	///< Buffer circular de registros
+} traco_t;
+
+extern traco_t traco;
+#endif
+
+#if cfg_PERFIL > 0
+#if (cfg_PERFIL & (cfg_PERFIL - 1)) != 0
+#error "cfg_PERFIL deve ser uma potencia de 2"
+#endif
+
+#define PERFIL_IDENTIFICADOR	0x50455246UL	/* "PERF" */
+#define PERFIL_TAM_NOME			8
+
+/**
+* \struct perfil_t
+* Buffer de amostras do perfil com o cabecalho usado pelo decodificador. 
+* Quando cheio, as amostras mais antigas sao sobrescritas.
+*/
+
+typedef struct
+{
+	uint32_t	identificador;		///< PERFIL_IDENTIFICADOR
+	uint32_t	frequencia;			///< Amostras por segundo
+	uint32_t	indice;				///< Total de amostras ja feitas; a proxima vai em indice % cfg_PERFIL
+	uint16_t	numero_amostras;	///< cfg_PERFIL
+	uint16_t	numero_nomes;		///< Linhas de nomes (NUMERO_DE_TAREFAS + 1)
+	char		nomes[NUMERO_DE_TAREFAS+1][PERFIL_TAM_NOME];	///< Nomes das tarefas, sem terminador se ocupam PERFIL_TAM_NOME
+	uint32_t	pc[cfg_PERFIL];		///< Endereco da instrucao interrompida
+	uint8_t		tarefa[cfg_PERFIL];	///< Tarefa interrompida (8 bits baixos do indice)
+} perfil_t;
+
+extern perfil_t perfil;
+#endif
+
 
 void tarefa_ociosa(void);
-uint8_t escalonador(void);
+id_tarefa_t escalonador(void);
 
 void TrocaContextoDasTarefas(void);
-uint32_t * CriaContexto(tarefa_t endereco_tarefa, uint32_t* ptr_pilha);
+uint32_t * CriaContexto(tarefa_t endereco_tarefa, uint32_t* ptr_pilha, uint16_t tamanho);
 void CriaTarefa(tarefa_t p, const char * nome, stackptr_t pilha, uint16_t tamanho, prioridade_t prioridade);
 void IniciaMultitarefas(void);
+#if cfg_PILHAS_DINAMICAS > 0
+id_tarefa_t TarefaCria(tarefa_t p, const char * nome, prioridade_t prioridade);
+#endif
+resultado_t TarefaTermina(id_tarefa_t id_tarefa);
+void FimDeTarefa(void);
+#if cfg_VERIFICA_PILHA
+#define PADRAO_PILHA	0xA5A5A5A5UL
+uint16_t TarefaPilhaLivre(id_tarefa_t id_tarefa);
+void EstouroDePilha(id_tarefa_t id_tarefa);
+#endif
+#if cfg_MEDE_TEMPO_TAREFAS || cfg_TRACO > 0
+uint32_t LeContadorDeCiclos(void);
+#endif
+#if cfg_MEDE_TEMPO_TAREFAS
+uint8_t TarefaUsoCPU(id_tarefa_t id_tarefa);
+#endif
+#if cfg_TRACO > 0
+void TracoMarca(uint16_t marca);
+uint32_t TracoMedeCusto(void);
+#endif
+#if cfg_PERFIL > 0
+void PerfilRegistra(uint32_t pc);
+void MarcaDeTempo(uint32_t pc);
+#endif
+#if cfg_MODO_PREEMPTIVO
+void ConfiguraModoPreemptivo(uint8_t habilitado);
+#endif
 void ConfiguraMarcaTempo(void);
-void ExecutaMarcaDeTempo(void);
+uint8_t ExecutaMarcaDeTempo(void);
+void CompensaMarcasDeTempo(tick_t qtas_marcas);
+tick_t DormeMarcasDeTempo(tick_t qtas_marcas);
 
-void TarefaSuspende(uint8_t id_tarefa);
-void TarefaContinua(uint8_t id_tarefa);
+resultado_t TarefaSuspende(id_tarefa_t id_tarefa);
+resultado_t TarefaContinua(id_tarefa_t id_tarefa);
 void TarefaEspera(tick_t qtas_marcas);		
+void TarefaEsperaAte(tick_t *ultimo_despertar, tick_t periodo);
+tick_t ObtemMarcaDeTempo(void);
 
 void SemaforoAguarda(semaforo_t* sem);
+resultado_t SemaforoAguardaTempo(semaforo_t* sem, tick_t tempo_maximo);
 void SemaforoLibera(semaforo_t* sem);
+
+void MutexAguarda(mutex_t* mutex);
+resultado_t MutexAguardaTempo(mutex_t* mutex, tick_t tempo_maximo);
+resultado_t MutexLibera(mutex_t* mutex);
+
+resultado_t MutexTetoObtem(mutex_teto_t* mutex);
+resultado_t MutexTetoLibera(mutex_teto_t* mutex);
+
+resultado_t FilaEnvia(fila_mensagens_t* fila, const void* item, tick_t tempo_maximo);
+resultado_t FilaRecebe(fila_mensagens_t* fila, void* item, tick_t tempo_maximo);
+resultado_t FilaEnviaPonteiro(fila_mensagens_t* fila, void* ponteiro, tick_t tempo_maximo);
+resultado_t FilaRecebePonteiro(fila_mensagens_t* fila, void** ponteiro, tick_t tempo_maximo);
+
+void EventosSinaliza(grupo_eventos_t* grupo, uint32_t eventos);
+void EventosLimpa(grupo_eventos_t* grupo, uint32_t eventos);
+resultado_t EventosAguarda(grupo_eventos_t* grupo, uint32_t eventos, uint8_t opcoes, uint32_t* obtidos, tick_t tempo_maximo);
+
+void PoolCria(pool_memoria_t* pool, void* area, uint16_t tamanho_bloco, uint16_t numero_blocos);
+void* PoolAloca(pool_memoria_t* pool, tick_t tempo_maximo);
+void PoolLibera(pool_memoria_t* pool, void* bloco);
+
+#if cfg_TAM_HEAP > 0
+void* HeapAloca(size_t tamanho);
+void HeapLibera(void* ptr);
+void HeapEstatisticas(heap_estatisticas_t* estatisticas);
+#endif
 #endif /* MULTITAREFAS_H_ */
\ No newline at end of file
@@ -0,0 +1,13 @@
+/*
+ * asf.h
+ *
+ * Substitui o asf.h do Atmel Software Framework no benchmark de escala, que
+ * executa no computador e nao usa nenhum arquivo do ASF.
+ */
+
+#ifndef ASF_H_
+#define ASF_H_
+
+#include <stdint.h>
+
+#endif /* ASF_H_ */
@@ -0,0 +1,406 @@
+/*
+ * bench_escala.c
+ *
+ * Mede, no computador, como o custo do nucleo cresce com o numero de tarefas
+ * (NUMERO_DE_TAREFAS) e de prioridades (PRIORIDADE_MAXIMA + 1), definidos na
+ * compilacao (ver Makefile):
+ *  - escalonador() com todas as tarefas prontas;
+ *  - ExecutaMarcaDeTempo() com todas as tarefas esperando tempo e nenhuma
+ *    despertando, e com todas despertando na mesma marca;
+ *  - as regioes atomicas (interrupcoes desabilitadas) dos servicos, cada um no
+ *    seu pior caso de listas: TarefaEspera no fim da lista temporizada,
+ *    SemaforoAguarda/SemaforoLibera com todas as tarefas na fila,
+ *    MutexAguarda/MutexLibera com todas as tarefas em uma cadeia de heranca,
+ *    FilaEnvia/FilaRecebe com todas as tarefas esperando envio ou recepcao,
+ *    EventosSinaliza acordando todas, PoolAloca/PoolLibera com todas
+ *    esperando bloco e HeapAloca/HeapLibera.
+ * Imprime uma linha CSV; com --cabecalho imprime antes os nomes das colunas.
+ * Os tempos sao em ns, descontado o custo de clock_gettime. Cada medida tem a
+ * media, o percentil 99 e o maximo de todas as amostras. O maximo inclui as
+ * interrupcoes do sistema operacional do computador; o percentil 99 as
+ * descarta sem esconder os caminhos lentos do nucleo, que se repetem em
+ * todas as rodadas. O caminho mais lento de um servico eh uma fracao
+ * pequena das suas regioes atomicas, por isso a amostra de cada servico eh a
+ * maior regiao da rodada; como quase toda rodada tem alguma regiao
+ * interrompida pelo sistema operacional, o pior caso das regioes eh a
+ * mediana dessas amostras (alem do maximo). Sai o servico com a maior
+ * mediana.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "rtos.h"
+
+#define RODADAS			200
+#define REPETICOES		100		/* chamadas por rodada */
+#define DESPERTARES		10		/* marcas com todas despertando, por rodada */
+#define ALOCACOES		32		/* blocos do heap alocados por rodada */
+
+#define HISTOGRAMA_NS	262144	/* tempos maiores ficam no ultimo intervalo */
+
+static uint32_t pilhas[NUMERO_DE_TAREFAS][TAM_MINIMO_PILHA];
+
+typedef struct
+{
+	double		soma_ns;
+	uint32_t	n;
+	uint64_t	max_ns;
+	uint32_t	histograma[HISTOGRAMA_NS];	/* amostras por ns */
+} medida_t;
+
+static uint64_t sobrecarga;
+static uint64_t inicio_regiao;
+static uint8_t em_regiao = 0;
+static medida_t *regiao = NULL;		/* servico cujas regioes atomicas sao medidas (NULL = nenhum) */
+static uint64_t maior_regiao;		/* maior regiao atomica da rodada */
+
+static uint64_t Agora(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+}
+
+/* tempo desde inicio, descontado o custo da medida */
+static uint64_t Decorrido(uint64_t inicio)
+{
+	uint64_t ns = Agora() - inicio;
+	return (ns > sobrecarga) ? ns - sobrecarga : 0;
+}
+
+static void Registra(medida_t *m, uint64_t ns)
+{
+	m->soma_ns += (double)ns;
+	if(ns > m->max_ns)
+	{
+		m->max_ns = ns;
+	}
+	m->histograma[(ns < HISTOGRAMA_NS) ? ns : HISTOGRAMA_NS - 1]++;
+	m->n++;
+}
+
+static double Media(const medida_t *m)
+{
+	return m->n ? m->soma_ns / m->n : 0.0;
+}
+
+/* menor tempo que nao eh superado por percentual % das amostras */
+static uint32_t Percentil(const medida_t *m, uint32_t percentual)
+{
+	uint64_t limite = ((uint64_t)m->n * percentual + 99) / 100;
+	uint64_t acumulado = 0;
+	uint32_t ns;
+
+	for(ns = 0; ns < HISTOGRAMA_NS - 1; ns++)
+	{
+		acumulado += m->histograma[ns];
+		if(acumulado >= limite)
+		{
+			break;
+		}
+	}
+	return ns;
+}
+
+void RegiaoAtomicaInicio(void)
+{
+	em_regiao = 1;
+	inicio_regiao = Agora();
+}
+
+void RegiaoAtomicaFim(void)
+{
+	uint64_t ns;
+
+	if(!em_regiao)
+	{
+		return;		/* a regiao ja terminou na troca de contexto */
+	}
+	ns = Decorrido(inicio_regiao);
+	em_regiao = 0;
+	if(ns > maior_regiao)
+	{
+		maior_regiao = ns;
+	}
+}
+
+/* registra a maior regiao atomica do servico medido ate aqui e passa a medir
+   as do servico m (NULL = nenhum) */
+static void MedeRegioes(medida_t *m)
+{
+	if(regiao != NULL)
+	{
+		Registra(regiao, maior_regiao);
+	}
+	regiao = m;
+	maior_regiao = 0;
+}
+
+/* o contexto nunca eh restaurado: so o ponteiro de pilha eh guardado */
+uint32_t *CriaContexto(tarefa_t endereco_tarefa, uint32_t *ptr_pilha, uint16_t tamanho)
+{
+	(void)endereco_tarefa;
+	(void)tamanho;
+	return ptr_pilha - TAM_CONTEXTO;
+}
+
+static void tarefa_vazia(void)
+{
+}
+
+/* numero de tarefas alem da ociosa, que eh a ultima criada */
+#define TAREFAS_USUARIO		(NUMERO_DE_TAREFAS - 1)
+
+static void EsperaTempo(id_tarefa_t tarefa, tick_t marcas)
+{
+	tarefa_atual = tarefa;
+	TarefaEspera(marcas);
+}
+
+/* as tarefas em ordem crescente de prioridade: na cadeia de mutexes, cada
+   uma que passa a esperar tem prioridade maior ou igual a todas as da frente
+   e a heranca percorre a cadeia inteira */
+static id_tarefa_t cadeia[TAREFAS_USUARIO];
+static mutex_t mutexes[NUMERO_DE_TAREFAS];
+
+static void MontaCadeia(void)
+{
+	prioridade_t p;
+	id_tarefa_t t;
+	uint32_t n = 0;
+
+	for(p = 1; p <= PRIORIDADE_MAXIMA; p++)
+	{
+		for(t = 1; t <= TAREFAS_USUARIO; t++)
+		{
+			if(TCB[t].prioridade_base == p)
+			{
+				cadeia[n++] = t;
+			}
+		}
+	}
+}
+
+/* cada tarefa obtem o seu mutex e espera pelo da anterior na cadeia; depois
+   a cadeia eh desfeita a partir da primeira, passando os mutexes adiante */
+static void CadeiaDeMutexes(void)
+{
+	uint32_t i;
+
+	for(i = 0; i < TAREFAS_USUARIO; i++)
+	{
+		tarefa_atual = cadeia[i];
+		MutexAguarda(&mutexes[cadeia[i]]);
+	}
+	for(i = 1; i < TAREFAS_USUARIO; i++)
+	{
+		tarefa_atual = cadeia[i];
+		MutexAguarda(&mutexes[cadeia[i - 1]]);
+	}
+	for(i = 0; i < TAREFAS_USUARIO; i++)
+	{
+		if(i > 0)
+		{
+			(void)MutexLibera(&mutexes[cadeia[i - 1]]);
+		}
+		tarefa_atual = cadeia[i];		/* a liberacao pode ter trocado de tarefa */
+		(void)MutexLibera(&mutexes[cadeia[i]]);
+	}
+}
+
+/* gerador pseudoaleatorio (xorshift32) para os tamanhos dos blocos do heap */
+static uint32_t Aleatorio(void)
+{
+	static uint32_t x = 2463534242u;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+/* as regioes atomicas de cada servico */
+static medida_t regiao_espera, regiao_semaforo, regiao_mutex, regiao_fila,
+	regiao_eventos, regiao_pool, regiao_heap;
+
+int main(int argc, char *argv[])
+{
+	static semaforo_t semaforo = {0, 0};
+	static grupo_eventos_t grupo = {0, 0};
+	static uint32_t area_fila[1], itens[NUMERO_DE_TAREFAS];
+	static fila_mensagens_t fila = FILA_MENSAGENS_INICIALIZADOR(area_fila, sizeof(uint32_t), 1);
+	static POOL_MEMORIA_AREA(area_pool, sizeof(void *), 1);
+	static pool_memoria_t pool;
+	static medida_t escalonador_m, marca_m, despertar_m;
+	static medida_t *regioes[] = {&regiao_espera, &regiao_semaforo, &regiao_mutex,
+		&regiao_fila, &regiao_eventos, &regiao_pool, &regiao_heap};
+	static const char *nomes_regioes[] = {"TarefaEspera", "SemaforoAguarda/Libera",
+		"MutexAguarda/Libera", "FilaEnvia/Recebe", "EventosAguarda/Sinaliza",
+		"PoolAloca/Libera", "HeapAloca/Libera"};
+	static void *blocos[ALOCACOES];
+	volatile id_tarefa_t escolhida;
+	id_tarefa_t t;
+	uint64_t inicio;
+	uint32_t i, rodada, pior, item = 0;
+	void *bloco;
+
+	for(t = 1; t <= TAREFAS_USUARIO; t++)
+	{
+		CriaTarefa(tarefa_vazia, "tarefa", pilhas[t - 1], TAM_MINIMO_PILHA,
+			(prioridade_t)(1 + (t - 1) % PRIORIDADE_MAXIMA));
+	}
+	CriaTarefa(tarefa_ociosa, "ociosa", pilhas[NUMERO_DE_TAREFAS - 1], TAM_MINIMO_PILHA, 0);
+	IniciaMultitarefas();
+	MontaCadeia();
+	PoolCria(&pool, area_pool, sizeof(void *), 1);
+
+	/* custo da propria medida */
+	sobrecarga = ~(uint64_t)0;
+	for(i = 0; i < RODADAS * REPETICOES; i++)
+	{
+		inicio = Agora();
+		inicio = Agora() - inicio;
+		if(inicio < sobrecarga)
+		{
+			sobrecarga = inicio;
+		}
+	}
+
+	for(rodada = 0; rodada < RODADAS; rodada++)
+	{
+		/* escalonador com todas as tarefas prontas */
+		for(i = 0; i < REPETICOES; i++)
+		{
+			inicio = Agora();
+			escolhida = escalonador();
+			Registra(&escalonador_m, Decorrido(inicio));
+		}
+
+		/* todas esperando tempo, cada uma no fim da lista temporizada; a marca
+		   de tempo so decrementa a primeira */
+		MedeRegioes(&regiao_espera);
+		for(t = 1; t <= TAREFAS_USUARIO; t++)
+		{
+			EsperaTempo(t, (tick_t)(1000000 + t));
+		}
+		MedeRegioes(NULL);
+		for(i = 0; i < REPETICOES; i++)
+		{
+			inicio = Agora();
+			(void)ExecutaMarcaDeTempo();
+			Registra(&marca_m, Decorrido(inicio));
+		}
+		CompensaMarcasDeTempo((tick_t)(1000000 + TAREFAS_USUARIO));		/* acorda todas */
+
+		/* todas despertando na mesma marca de tempo */
+		for(i = 0; i < DESPERTARES; i++)
+		{
+			for(t = 1; t <= TAREFAS_USUARIO; t++)
+			{
+				EsperaTempo(t, 1);
+			}
+			inicio = Agora();
+			(void)ExecutaMarcaDeTempo();
+			Registra(&despertar_m, Decorrido(inicio));
+		}
+
+		/* todas na fila do semaforo, que eh ordenada por prioridade */
+		MedeRegioes(&regiao_semaforo);
+		for(t = 1; t <= TAREFAS_USUARIO; t++)
+		{
+			tarefa_atual = t;
+			SemaforoAguarda(&semaforo);
+		}
+		for(t = 1; t <= TAREFAS_USUARIO; t++)
+		{
+			SemaforoLibera(&semaforo);
+		}
+
+		/* todas em uma cadeia de heranca de prioridade */
+		MedeRegioes(&regiao_mutex);
+		CadeiaDeMutexes();
+
+		/* todas esperando recepcao na fila vazia e depois envio na fila cheia */
+		MedeRegioes(&regiao_fila);
+		for(t = 1; t <= TAREFAS_USUARIO; t++)
+		{
+			tarefa_atual = t;
+			(void)FilaRecebe(&fila, &itens[t], ESPERA_INFINITA);
+		}
+		for(t = 1; t <= TAREFAS_USUARIO; t++)
+		{
+			(void)FilaEnvia(&fila, &item, ESPERA_INFINITA);
+		}
+		(void)FilaEnvia(&fila, &item, 0);
+		for(t = 1; t <= TAREFAS_USUARIO; t++)
+		{
+			tarefa_atual = t;
+			(void)FilaEnvia(&fila, &itens[t], ESPERA_INFINITA);
+		}
+		for(t = 0; t <= TAREFAS_USUARIO; t++)
+		{
+			(void)FilaRecebe(&fila, &item, ESPERA_INFINITA);
+		}
+
+		/* todas esperando o mesmo evento, acordadas de uma vez */
+		MedeRegioes(&regiao_eventos);
+		for(t = 1; t <= TAREFAS_USUARIO; t++)
+		{
+			tarefa_atual = t;
+			(void)EventosAguarda(&grupo, 1, EVENTOS_QUALQUER | EVENTOS_LIMPA, NULL, ESPERA_INFINITA);
+		}
+		EventosSinaliza(&grupo, 1);
+
+		/* todas esperando o unico bloco, passado de uma para a outra */
+		MedeRegioes(&regiao_pool);
+		bloco = PoolAloca(&pool, 0);
+		for(t = 1; t <= TAREFAS_USUARIO; t++)
+		{
+			tarefa_atual = t;
+			(void)PoolAloca(&pool, ESPERA_INFINITA);
+		}
+		for(t = 0; t <= TAREFAS_USUARIO; t++)
+		{
+			PoolLibera(&pool, bloco);
+		}
+
+		/* blocos de tamanhos variados, liberados fora de ordem */
+		MedeRegioes(&regiao_heap);
+		for(i = 0; i < ALOCACOES; i++)
+		{
+			blocos[i] = HeapAloca(8 + Aleatorio() % 248);
+		}
+		for(i = 0; i < ALOCACOES; i++)
+		{
+			HeapLibera(blocos[(i * 7) % ALOCACOES]);
+		}
+		MedeRegioes(NULL);
+	}
+	(void)escolhida;
+
+	pior = 0;
+	for(i = 1; i < sizeof(regioes) / sizeof(regioes[0]); i++)
+	{
+		if(Percentil(regioes[i], 50) > Percentil(regioes[pior], 50))
+		{
+			pior = i;
+		}
+	}
+
+	if(argc > 1 && strcmp(argv[1], "--cabecalho") == 0)
+	{
+		printf("tarefas,prioridades,escalonador_ns,escalonador_p99_ns,escalonador_max_ns,"
+			"marca_ns,marca_p99_ns,marca_max_ns,"
+			"marca_todas_despertam_ns,marca_todas_despertam_p99_ns,marca_todas_despertam_max_ns,"
+			"regiao_atomica_p50_ns,regiao_atomica_max_ns,regiao_atomica_servico\n");
+	}
+	printf("%d,%d,%.1f,%u,%llu,%.1f,%u,%llu,%.1f,%u,%llu,%u,%llu,%s\n",
+		NUMERO_DE_TAREFAS, PRIORIDADE_MAXIMA + 1,
+		Media(&escalonador_m), (unsigned)Percentil(&escalonador_m, 99), (unsigned long long)escalonador_m.max_ns,
+		Media(&marca_m), (unsigned)Percentil(&marca_m, 99), (unsigned long long)marca_m.max_ns,
+		Media(&despertar_m), (unsigned)Percentil(&despertar_m, 99), (unsigned long long)despertar_m.max_ns,
+		(unsigned)Percentil(regioes[pior], 50), (unsigned long long)regioes[pior]->max_ns, nomes_regioes[pior]);
+
+	return 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * cpu-port.h
+ *
+ * Porta do nucleo para o benchmark de escala, executado no computador. Nao ha
+ * troca de contexto de verdade: TROCA_CONTEXTO chama diretamente 
+ * TrocaContextoDasTarefas, que so escolhe a proxima tarefa, e o benchmark faz
+ * o papel de cada tarefa mudando tarefa_atual antes de chamar os servicos.
+ * As regioes atomicas sao cronometradas para obter o maior tempo com as 
+ * interrupcoes desabilitadas.
+ */
+
+#ifndef CPU_PORT_H_
+#define CPU_PORT_H_
+
+#include <stdint.h>
+
+#define TAM_MINIMO_PILHA	(16)
+
+typedef uint32_t* stackptr_t;
+
+#define TAM_CONTEXTO		16
+#define CONTEXTO_INICIAL(ptr_pilha, endereco_tarefa, tamanho)	do{ (void)(ptr_pilha); (void)(endereco_tarefa); (void)(tamanho); }while(0)
+
+void RegiaoAtomicaInicio(void);
+void RegiaoAtomicaFim(void);
+void TrocaContextoDasTarefas(void);
+
+#define REG_ATOMICA_INICIO()	RegiaoAtomicaInicio();
+#define REG_ATOMICA_FIM()		RegiaoAtomicaFim();
+
+/* como no Cortex-M0, a troca de contexto reabilita as interrupcoes */
+#define TROCA_CONTEXTO()		RegiaoAtomicaFim(); TrocaContextoDasTarefas();
+#define TrocaContexto()			TROCA_CONTEXTO()
+
+#define GERA_INTERRUPCAO_SW()
+#define DORME_ATE_INTERRUPCAO()
+#define BARREIRA_MEMORIA()		__asm volatile("" ::: "memory");
+
+#endif /* CPU_PORT_H_ */
@@ -0,0 +1,199 @@
+/*
+ * bench_heap.c
+ *
+ * Compara o heap TLSF (heap_tlsf.c) com o malloc/free da biblioteca C do
+ * computador em sequencias aleatorias de alocacoes e liberacoes, medindo o 
+ * tempo medio e o pior tempo de cada operacao e a fragmentacao do TLSF.
+ *
+ * Uso: bench_heap [operacoes] [semente]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "heap_tlsf.h"
+
+#define TAM_AREA		(32 * 1024)		/* RAM disponivel em um SAMD21 */
+#define MAX_VIVOS		256
+
+typedef struct
+{
+	const char	*nome;
+	size_t		minimo, maximo;		/* faixa de tamanhos alocados */
+	uint32_t	vivos;				/* numero maximo de blocos alocados ao mesmo tempo */
+} cenario_t;
+
+#define HISTOGRAMA_NS	100000			/* tempos acima disso so contam no pior caso */
+
+typedef struct
+{
+	double		soma_ns;
+	uint64_t	max_ns;
+	uint32_t	n;
+	uint32_t	falhas;
+	uint32_t	histograma[HISTOGRAMA_NS];
+} medida_t;
+
+static const cenario_t cenarios[] = 
+{
+	{"quadros ate 255 bytes", 1, 255, 64},
+	{"mensagens 8-64 bytes", 8, 64, 200},
+	{"tamanhos 1-2048 bytes", 1, 2048, 24},
+};
+
+static heap_t heap;
+static uint8_t area[TAM_AREA];
+
+static uint64_t Agora(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+}
+
+static void Registra(medida_t *m, uint64_t ns)
+{
+	m->histograma[(ns < HISTOGRAMA_NS) ? ns : HISTOGRAMA_NS - 1]++;
+	m->soma_ns += (double)ns;
+	if(ns > m->max_ns)
+	{
+		m->max_ns = ns;
+	}
+	m->n++;
+}
+
+/* tempo abaixo do qual ficam fracao das medidas */
+static uint32_t Percentil(const medida_t *m, double fracao)
+{
+	uint64_t acumulado = 0;
+	uint32_t ns;
+	
+	for(ns = 0; ns < HISTOGRAMA_NS; ns++)
+	{
+		acumulado += m->histograma[ns];
+		if(acumulado >= fracao * m->n)
+		{
+			break;
+		}
+	}
+	return ns;
+}
+
+/* o pior caso absoluto inclui interrupcoes e trocas de processo do sistema 
+   operacional do computador; o percentil 99,99 mostra o pior caso do alocador */
+static void Imprime(const char *alocador, const char *operacao, const medida_t *m)
+{
+	printf("  %-7s %-7s media %6.1f ns  p99,99 %6u ns  pior %8llu ns  (%u operacoes, %u falhas)\n",
+		alocador, operacao, m->n ? m->soma_ns / m->n : 0.0, Percentil(m, 0.9999),
+		(unsigned long long)m->max_ns, m->n, m->falhas);
+}
+
+/* executa a mesma sequencia aleatoria com o TLSF (usa_tlsf = 1) ou o malloc */
+static void Executa(const cenario_t *c, uint32_t operacoes, unsigned semente, int usa_tlsf)
+{
+	static medida_t aloca, libera;
+	void *vivos[MAX_VIVOS] = {0};
+	size_t tamanhos[MAX_VIVOS] = {0};
+	heap_estatisticas_t est;
+	uint32_t i, k;
+	size_t tamanho;
+	uint64_t t0;
+	void *p;
+	
+	memset(&aloca, 0, sizeof(aloca));
+	memset(&libera, 0, sizeof(libera));
+	srand(semente);
+	if(usa_tlsf)
+	{
+		HeapTLSFInicia(&heap, area, sizeof(area));
+	}
+	
+	for(i = 0; i < operacoes; i++)
+	{
+		k = (uint32_t)rand() % c->vivos;
+		if(vivos[k] == NULL)
+		{
+			tamanho = c->minimo + (size_t)rand() % (c->maximo - c->minimo + 1);
+			t0 = Agora();
+			p = usa_tlsf ? HeapTLSFAloca(&heap, tamanho) : malloc(tamanho);
+			Registra(&aloca, Agora() - t0);
+			if(p == NULL)
+			{
+				aloca.falhas++;
+			}else
+			{
+				memset(p, (int)k, tamanho);		/* usa o bloco, como a aplicacao */
+			}
+			vivos[k] = p;
+			tamanhos[k] = tamanho;
+		}else
+		{
+			/* o conteudo nao pode ter sido alterado por outra alocacao */
+			for(tamanho = 0; tamanho < tamanhos[k]; tamanho++)
+			{
+				if(((uint8_t *)vivos[k])[tamanho] != (uint8_t)k)
+				{
+					printf("  ERRO: bloco sobreposto\n");
+					exit(1);
+				}
+			}
+			t0 = Agora();
+			if(usa_tlsf)
+			{
+				HeapTLSFLibera(&heap, vivos[k]);
+			}else
+			{
+				free(vivos[k]);
+			}
+			Registra(&libera, Agora() - t0);
+			vivos[k] = NULL;
+		}
+	}
+	
+	if(usa_tlsf)
+	{
+		HeapTLSFEstatisticas(&heap, &est);
+	}
+	
+	for(k = 0; k < MAX_VIVOS; k++)
+	{
+		if(usa_tlsf)
+		{
+			HeapTLSFLibera(&heap, vivos[k]);
+		}else
+		{
+			free(vivos[k]);
+		}
+	}
+	
+	Imprime(usa_tlsf ? "tlsf" : "malloc", "aloca", &aloca);
+	Imprime(usa_tlsf ? "tlsf" : "malloc", "libera", &libera);
+	if(usa_tlsf)
+	{
+		printf("  tlsf    livre minimo %zu de %zu bytes, %u blocos livres, fragmentacao %u%%\n",
+			est.livre_minimo, heap.total, est.blocos_livres, est.fragmentacao);
+		HeapTLSFEstatisticas(&heap, &est);
+		if(est.blocos_livres != 1 || est.livre != heap.total)
+		{
+			printf("  ERRO: heap nao voltou a um unico bloco livre\n");
+			exit(1);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t operacoes = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 1000000;
+	unsigned semente = (argc > 2) ? (unsigned)strtoul(argv[2], NULL, 0) : 1;
+	size_t i;
+	
+	for(i = 0; i < sizeof(cenarios) / sizeof(cenarios[0]); i++)
+	{
+		printf("%s, ate %u blocos vivos:\n", cenarios[i].nome, cenarios[i].vivos);
+		Executa(&cenarios[i], operacoes, semente, 1);
+		Executa(&cenarios[i], operacoes, semente, 0);
+	}
+	
+	return 0;
+}
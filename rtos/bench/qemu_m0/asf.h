@@ -0,0 +1,14 @@
+/*
+ * asf.h
+ *
+ * Substitui o asf.h do Atmel Software Framework no benchmark: o nucleo e o 
+ * cpu-port.c so usam os registradores do nucleo Cortex-M0, definidos em 
+ * cpu-port.h, entao nenhum arquivo do ASF eh necessario.
+ */
+
+#ifndef ASF_H_
+#define ASF_H_
+
+#include <stdint.h>
+
+#endif /* ASF_H_ */
@@ -0,0 +1,191 @@
+/*
+ * bench_marca.c
+ *
+ * Mede a rotina da marca de tempo (SysTick_Handler) no Cortex-M0 emulado pelo
+ * QEMU em funcao do numero de tarefas dormindo, DORMINHOCAS, definido na
+ * compilacao (o Makefile varre varios valores e junta as linhas em marca.csv):
+ *  - sem despertar: todas as dorminhocas na lista temporizada, longe de
+ *    acordar; a marca so decrementa a primeira;
+ *  - todas despertam: as dorminhocas e a tarefa de controle acordam na mesma
+ *    marca de tempo.
+ * A duracao de cada marca vem de ciclos_marca_tempo (cfg_MEDE_MARCA_TEMPO), em
+ * contagens do SysTick. A saida eh uma linha CSV pelo semihosting:
+ *
+ *     tarefas,sem_despertar_media,sem_despertar_maximo,
+ *     todas_despertam_media,todas_despertam_maximo
+ *
+ * (tarefas conta as dorminhocas, sem a de controle e a ociosa)
+ */
+
+#include "rtos.h"
+#include "semihosting.h"
+
+#if !cfg_MEDE_MARCA_TEMPO
+#error "o benchmark precisa de cfg_MEDE_MARCA_TEMPO = 1"
+#endif
+
+#ifndef DORMINHOCAS
+#define DORMINHOCAS		8
+#endif
+
+#if NUMERO_DE_TAREFAS != DORMINHOCAS + 2
+#error "NUMERO_DE_TAREFAS deve ser DORMINHOCAS + 2 (controle e ociosa)"
+#endif
+
+#define AMOSTRAS		200
+#define ANTECEDENCIA	3		/* marcas para todas dormirem antes do despertar */
+#define MAIOR_SONO		(AMOSTRAS + 2 * ANTECEDENCIA)
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 96)
+#define TAM_PILHA_DORMINHOCA	(TAM_MINIMO_PILHA + 48)
+
+typedef struct
+{
+	uint32_t	n;
+	uint32_t	soma;
+	uint32_t	maximo;
+} medida_t;
+
+/* duracao da ultima marca de tempo (cpu-port.c) */
+extern volatile uint32_t ciclos_marca_tempo;
+
+uint32_t pilha_controle[TAM_PILHA];
+uint32_t pilhas_dorminhocas[DORMINHOCAS][TAM_PILHA_DORMINHOCA];
+uint32_t pilha_ociosa[TAM_PILHA];
+
+static semaforo_t partida = {0, 0};
+static semaforo_t acordou = {0, 0};
+static volatile tick_t despertar;		/* marca em que todas acordam */
+static volatile uint32_t atrasadas;		/* dorminhocas que nao dormiram a tempo */
+
+static medida_t m_sem_despertar, m_todas_despertam;
+
+static void Registra(medida_t *m, uint32_t ciclos)
+{
+	if(ciclos > m->maximo)
+	{
+		m->maximo = ciclos;
+	}
+	m->soma += ciclos;
+	m->n++;
+}
+
+static void Imprime(medida_t *m)
+{
+	Escreve(",");
+	EscreveNumero(m->n ? m->soma / m->n : 0);
+	Escreve(",");
+	EscreveNumero(m->maximo);
+}
+
+/* prioridade 1: dorme ate a marca de despertar de cada rodada */
+void dorminhoca(void)
+{
+	tick_t espera;
+
+	for(;;)
+	{
+		SemaforoAguarda(&partida);
+
+		/* se a marca de despertar ja passou, a diferenca da a volta */
+		espera = despertar - ObtemMarcaDeTempo();
+		if(espera == 0 || espera > MAIOR_SONO)
+		{
+			atrasadas++;
+		}else
+		{
+			TarefaEspera(espera);
+		}
+
+		SemaforoLibera(&acordou);
+	}
+}
+
+/* poe todas as dorminhocas para dormir ate daqui a marcas marcas de tempo */
+static void Adormece(tick_t marcas)
+{
+	uint32_t i;
+
+	despertar = ObtemMarcaDeTempo() + marcas;
+	for(i = 0; i < DORMINHOCAS; i++)
+	{
+		SemaforoLibera(&partida);
+	}
+}
+
+/* espera todas as dorminhocas acordarem e voltarem a esperar a partida */
+static void AguardaDespertar(void)
+{
+	uint32_t i;
+
+	for(i = 0; i < DORMINHOCAS; i++)
+	{
+		SemaforoAguarda(&acordou);
+	}
+}
+
+/* prioridade 2: comanda as rodadas e mede as marcas que a interrompem ou que
+   a acordam */
+void tarefa_controle(void)
+{
+	uint32_t i;
+	tick_t marca;
+
+	/* sem despertar: as dorminhocas dormem ate depois das amostras; a tarefa
+	   de controle espera sem dormir e mede cada marca que a interrompe */
+	Adormece(MAIOR_SONO);
+	TarefaEspera(ANTECEDENCIA);		/* todas dormem */
+	for(i = 0; i < AMOSTRAS; i++)
+	{
+		marca = ObtemMarcaDeTempo();
+		while(ObtemMarcaDeTempo() == marca)
+		{
+		}
+		Registra(&m_sem_despertar, ciclos_marca_tempo);
+	}
+	AguardaDespertar();
+
+	/* todas despertam: a tarefa de controle acorda na mesma marca e, com a
+	   maior prioridade, executa primeiro e le a duracao dessa marca */
+	for(i = 0; i < AMOSTRAS; i++)
+	{
+		Adormece(ANTECEDENCIA);
+		TarefaEspera(despertar - ObtemMarcaDeTempo());
+		Registra(&m_todas_despertam, ciclos_marca_tempo);
+		AguardaDespertar();
+	}
+
+	if(atrasadas != 0)
+	{
+		Escreve("dorminhocas atrasadas: a medida nao vale\n");
+		Termina(0);
+	}
+
+	Escreve("tarefas,sem_despertar_media,sem_despertar_maximo,"
+		"todas_despertam_media,todas_despertam_maximo\n");
+	EscreveNumero(DORMINHOCAS);
+	Imprime(&m_sem_despertar);
+	Imprime(&m_todas_despertam);
+	Escreve("\n");
+
+	Termina(1);
+}
+
+int main(void)
+{
+	uint32_t i;
+
+	CriaTarefa(tarefa_controle, "controle", pilha_controle, TAM_PILHA, 2);
+	for(i = 0; i < DORMINHOCAS; i++)
+	{
+		CriaTarefa(dorminhoca, "dorminhoca", pilhas_dorminhocas[i], TAM_PILHA_DORMINHOCA, 1);
+	}
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+
+	IniciaMultitarefas();
+
+	for(;;)
+	{
+	}
+}
@@ -0,0 +1,367 @@
+/*
+ * bench_nucleo.c
+ *
+ * Mede o custo das operacoes basicas do nucleo no Cortex-M0 emulado pelo QEMU
+ * (micro:bit): troca de contexto, passagem de semaforo (SemaforoLibera ate a
+ * volta de SemaforoAguarda na tarefa acordada), despertar de TarefaEspera,
+ * rotina de marca de tempo, mutex com teto contra semaforo usado como mutex e
+ * fila de mensagens contra buffer com dois semaforos. Cada operacao eh
+ * repetida ITERACOES vezes e os resultados saem pelo semihosting em CSV:
+ *
+ *     teste,amostras,media,minimo,maximo
+ *
+ * Os tempos sao contagens do SysTick: o Cortex-M0 nao tem contador de ciclos,
+ * entao o tempo eh o numero de marcas de tempo vezes os ciclos por marca mais
+ * o valor do contador do SysTick. Com -icount o relogio virtual do QEMU avanca
+ * com as instrucoes executadas, e as contagens sao deterministicas e
+ * proporcionais ao numero de instrucoes. Na placa sao ciclos de clock.
+ * Nos testes medidos pelo tempo total (troca de contexto e vazao de mensagens)
+ * so ha a media; o maximo das demais inclui as marcas de tempo que caem
+ * dentro de uma medida.
+ */
+
+#include "rtos.h"
+#include "semihosting.h"
+
+#if !cfg_MEDE_MARCA_TEMPO
+#error "o benchmark precisa de cfg_MEDE_MARCA_TEMPO = 1"
+#endif
+
+#define ITERACOES		1000
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 96)
+#define TAM_BUFFER		8
+
+/* bits de partida de cada tarefa auxiliar no grupo de eventos */
+#define TAREFA_ALTA		(1UL << 0)
+#define TAREFA_BAIXA	(1UL << 1)
+#define TAREFA_PAR		(1UL << 2)
+
+typedef enum
+{
+	TESTE_TROCA,
+	TESTE_SEMAFORO,
+	TESTE_ESPERA,
+	TESTE_MARCA_OCIOSA,
+	TESTE_FILA,
+	TESTE_DOIS_SEMAFOROS
+} teste_t;
+
+typedef struct
+{
+	uint32_t	n;
+	uint32_t	soma;
+	uint32_t	minimo;
+	uint32_t	maximo;		/* 0 = so ha a media */
+} medida_t;
+
+/* duracao da ultima marca de tempo (cpu-port.c) */
+extern volatile uint32_t ciclos_marca_tempo;
+
+uint32_t pilha_controle[TAM_PILHA];
+uint32_t pilha_alta[TAM_PILHA];
+uint32_t pilha_baixa[TAM_PILHA];
+uint32_t pilha_par[TAM_PILHA];
+uint32_t pilha_ociosa[TAM_PILHA];
+
+static volatile teste_t teste;
+static grupo_eventos_t partida = {0, 0};
+static semaforo_t fim = {0, 0};
+
+static volatile uint32_t instante;		/* inicio da medida feita por outra tarefa */
+static uint32_t sobrecarga;				/* custo de uma leitura de Ciclos() */
+
+static semaforo_t sem_passagem = {0, 0};
+static semaforo_t sem_mutex = {1, 0};
+static mutex_teto_t mutex_teto = {3, 0, 0, 0};
+
+static uint32_t area_fila[TAM_BUFFER];
+static fila_mensagens_t fila = FILA_MENSAGENS_INICIALIZADOR(area_fila, sizeof(uint32_t), TAM_BUFFER);
+
+static uint32_t buffer[TAM_BUFFER];
+static semaforo_t sem_vazio = {TAM_BUFFER, 0};
+static semaforo_t sem_cheio = {0, 0};
+
+static medida_t m_troca, m_semaforo, m_espera, m_marca_despertar, m_marca_ociosa;
+static medida_t m_mutex_teto, m_semaforo_mutex, m_fila, m_dois_semaforos;
+
+/* tempo em contagens do SysTick; a marca de tempo eh lida de novo para
+   descartar a leitura se o contador voltou a recarga no meio */
+static uint32_t Ciclos(void)
+{
+	uint32_t marcas, ciclos;
+
+	do
+	{
+		marcas = (uint32_t)ObtemMarcaDeTempo();
+		ciclos = CICLOS_DESDE_MARCA();
+	}while((uint32_t)ObtemMarcaDeTempo() != marcas);
+
+	return marcas * CICLOS_POR_MARCA() + ciclos;
+}
+
+static void Registra(medida_t *m, uint32_t ciclos)
+{
+	if(m->n == 0 || ciclos < m->minimo)
+	{
+		m->minimo = ciclos;
+	}
+	if(ciclos > m->maximo)
+	{
+		m->maximo = ciclos;
+	}
+	m->soma += ciclos;
+	m->n++;
+}
+
+static void RegistraTotal(medida_t *m, uint32_t ciclos, uint32_t n)
+{
+	m->soma = ciclos;
+	m->n = n;
+}
+
+static void Imprime(const char *nome, medida_t *m)
+{
+	Escreve(nome);
+	Escreve(",");
+	EscreveNumero(m->n);
+	Escreve(",");
+	EscreveNumero(m->n ? m->soma / m->n : 0);
+	Escreve(",");
+	if(m->maximo != 0)
+	{
+		EscreveNumero(m->minimo);
+		Escreve(",");
+		EscreveNumero(m->maximo);
+	}else
+	{
+		Escreve(",");
+	}
+	Escreve("\n");
+}
+
+/* a tarefa cede o processador para a proxima pronta de mesma prioridade */
+static void Cede(void)
+{
+	REG_ATOMICA_INICIO();
+	TrocaContexto();
+	REG_ATOMICA_FIM();
+}
+
+static void AguardaPartida(uint32_t tarefa)
+{
+	(void)EventosAguarda(&partida, tarefa, EVENTOS_QUALQUER | EVENTOS_LIMPA, NULL, ESPERA_INFINITA);
+}
+
+/* inicia o teste nas tarefas auxiliares e espera todas terminarem */
+static void Executa(teste_t t, uint32_t tarefas)
+{
+	teste = t;
+	EventosSinaliza(&partida, tarefas);
+	for(; tarefas != 0; tarefas &= tarefas - 1)
+	{
+		SemaforoAguarda(&fim);
+	}
+}
+
+/* prioridade 3: recebe semaforos e mensagens e mede os despertares */
+void tarefa_alta(void)
+{
+	uint32_t i, item, marca, leitura = 0;
+
+	for(;;)
+	{
+		AguardaPartida(TAREFA_ALTA);
+
+		switch(teste)
+		{
+		case TESTE_SEMAFORO:
+			for(i = 0; i < ITERACOES; i++)
+			{
+				SemaforoAguarda(&sem_passagem);
+				Registra(&m_semaforo, Ciclos() - instante - sobrecarga);
+			}
+			break;
+
+		case TESTE_ESPERA:
+			for(i = 0; i < ITERACOES; i++)
+			{
+				TarefaEspera(1);
+				Registra(&m_espera, CICLOS_DESDE_MARCA());
+				Registra(&m_marca_despertar, ciclos_marca_tempo);
+			}
+			break;
+
+		case TESTE_MARCA_OCIOSA:
+			/* nenhuma tarefa espera tempo: a marca so conta e verifica a fatia */
+			for(i = 0; i < ITERACOES; i++)
+			{
+				marca = (uint32_t)ObtemMarcaDeTempo();
+				while((uint32_t)ObtemMarcaDeTempo() == marca)
+				{
+				}
+				Registra(&m_marca_ociosa, ciclos_marca_tempo);
+			}
+			break;
+
+		case TESTE_FILA:
+			for(i = 0; i < ITERACOES; i++)
+			{
+				(void)FilaRecebe(&fila, &item, ESPERA_INFINITA);
+			}
+			RegistraTotal(&m_fila, Ciclos() - instante, ITERACOES);
+			break;
+
+		case TESTE_DOIS_SEMAFOROS:
+			for(i = 0; i < ITERACOES; i++)
+			{
+				SemaforoAguarda(&sem_cheio);
+				item = buffer[leitura];
+				leitura = (leitura + 1) % TAM_BUFFER;
+				SemaforoLibera(&sem_vazio);
+			}
+			RegistraTotal(&m_dois_semaforos, Ciclos() - instante, ITERACOES);
+			break;
+
+		default:
+			break;
+		}
+
+		(void)item;
+		SemaforoLibera(&fim);
+	}
+}
+
+/* prioridade 2: libera semaforos, produz mensagens e cede o processador */
+void tarefa_baixa(void)
+{
+	uint32_t i, escrita = 0;
+
+	for(;;)
+	{
+		AguardaPartida(TAREFA_BAIXA);
+
+		switch(teste)
+		{
+		case TESTE_TROCA:
+			instante = Ciclos();
+			for(i = 0; i < ITERACOES; i++)
+			{
+				Cede();
+			}
+			RegistraTotal(&m_troca, Ciclos() - instante, 2 * ITERACOES);
+			break;
+
+		case TESTE_SEMAFORO:
+			for(i = 0; i < ITERACOES; i++)
+			{
+				instante = Ciclos();
+				SemaforoLibera(&sem_passagem);
+			}
+			break;
+
+		case TESTE_FILA:
+			instante = Ciclos();
+			for(i = 0; i < ITERACOES; i++)
+			{
+				(void)FilaEnvia(&fila, &i, ESPERA_INFINITA);
+			}
+			break;
+
+		case TESTE_DOIS_SEMAFOROS:
+			instante = Ciclos();
+			for(i = 0; i < ITERACOES; i++)
+			{
+				SemaforoAguarda(&sem_vazio);
+				buffer[escrita] = i;
+				escrita = (escrita + 1) % TAM_BUFFER;
+				SemaforoLibera(&sem_cheio);
+			}
+			break;
+
+		default:
+			break;
+		}
+
+		SemaforoLibera(&fim);
+	}
+}
+
+/* prioridade 2: par da tarefa_baixa na troca de contexto */
+void tarefa_par(void)
+{
+	uint32_t i;
+
+	for(;;)
+	{
+		AguardaPartida(TAREFA_PAR);
+
+		for(i = 0; i < ITERACOES; i++)
+		{
+			Cede();
+		}
+
+		SemaforoLibera(&fim);
+	}
+}
+
+/* prioridade 1: executa os testes em sequencia, mede os mutexes e imprime */
+void tarefa_controle(void)
+{
+	uint32_t i, inicio;
+
+	inicio = Ciclos();
+	sobrecarga = Ciclos() - inicio;
+
+	Executa(TESTE_TROCA, TAREFA_BAIXA | TAREFA_PAR);
+	Executa(TESTE_SEMAFORO, TAREFA_ALTA | TAREFA_BAIXA);
+	Executa(TESTE_ESPERA, TAREFA_ALTA);
+	Executa(TESTE_MARCA_OCIOSA, TAREFA_ALTA);
+	Executa(TESTE_FILA, TAREFA_ALTA | TAREFA_BAIXA);
+	Executa(TESTE_DOIS_SEMAFOROS, TAREFA_ALTA | TAREFA_BAIXA);
+
+	/* sem disputa: o custo de obter e liberar o recurso */
+	for(i = 0; i < ITERACOES; i++)
+	{
+		inicio = Ciclos();
+		(void)MutexTetoObtem(&mutex_teto);
+		(void)MutexTetoLibera(&mutex_teto);
+		Registra(&m_mutex_teto, Ciclos() - inicio - sobrecarga);
+	}
+	for(i = 0; i < ITERACOES; i++)
+	{
+		inicio = Ciclos();
+		SemaforoAguarda(&sem_mutex);
+		SemaforoLibera(&sem_mutex);
+		Registra(&m_semaforo_mutex, Ciclos() - inicio - sobrecarga);
+	}
+
+	Escreve("teste,amostras,media,minimo,maximo\n");
+	Imprime("troca_contexto", &m_troca);
+	Imprime("semaforo_libera_aguarda", &m_semaforo);
+	Imprime("espera_despertar", &m_espera);
+	Imprime("marca_tempo_despertar", &m_marca_despertar);
+	Imprime("marca_tempo_ociosa", &m_marca_ociosa);
+	Imprime("mutex_teto_obtem_libera", &m_mutex_teto);
+	Imprime("semaforo_aguarda_libera", &m_semaforo_mutex);
+	Imprime("fila_mensagem", &m_fila);
+	Imprime("dois_semaforos_mensagem", &m_dois_semaforos);
+
+	Termina(1);
+}
+
+int main(void)
+{
+	CriaTarefa(tarefa_controle, "controle", pilha_controle, TAM_PILHA, 1);
+	CriaTarefa(tarefa_alta, "alta", pilha_alta, TAM_PILHA, 3);
+	CriaTarefa(tarefa_baixa, "baixa", pilha_baixa, TAM_PILHA, 2);
+	CriaTarefa(tarefa_par, "par", pilha_par, TAM_PILHA, 2);
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+
+	IniciaMultitarefas();
+
+	for(;;)
+	{
+	}
+}
@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+compara.py
+
+Compara dois resultados do benchmark do nucleo (CSV de bench_nucleo) e 
+termina com erro se a media de algum teste cresceu mais que a tolerancia.
+
+Uso: compara.py base.csv novo.csv [--tolerancia 5]
+"""
+
+import argparse
+import csv
+import sys
+
+
+def le(arquivo):
+    with open(arquivo) as f:
+        return {linha['teste']: linha for linha in csv.DictReader(f)}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compara resultados do benchmark do nucleo')
+    parser.add_argument('base')
+    parser.add_argument('novo')
+    parser.add_argument('--tolerancia', type=float, default=5.0, help='aumento maximo da media, em %%')
+    args = parser.parse_args()
+
+    base = le(args.base)
+    novo = le(args.novo)
+    pior = False
+
+    print('%-26s %10s %10s %8s' % ('teste', 'base', 'novo', 'variacao'))
+    for teste, linha in novo.items():
+        if teste not in base:
+            print('%-26s %10s %10s %8s' % (teste, '-', linha['media'], 'novo'))
+            continue
+        antes = float(base[teste]['media'])
+        agora = float(linha['media'])
+        variacao = 100.0 * (agora - antes) / antes if antes else 0.0
+        marca = ''
+        if variacao > args.tolerancia:
+            marca = '  <-- mais lento'
+            pior = True
+        print('%-26s %10.0f %10.0f %+7.1f%%%s' % (teste, antes, agora, variacao, marca))
+
+    sys.exit(1 if pior else 0)
+
+
+if __name__ == '__main__':
+    main()
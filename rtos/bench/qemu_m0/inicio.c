@@ -0,0 +1,60 @@
+/*
+ * inicio.c
+ *
+ * Tabela de vetores e codigo de inicializacao do benchmark para o Cortex-M0 
+ * do micro:bit (nRF51) emulado pelo QEMU. Os tratadores de SVC, PendSV, 
+ * SysTick e HardFault sao os de cpu-port.c.
+ */
+
+#include <stdint.h>
+
+extern uint32_t _sidata, _sdata, _edata, _sbss, _ebss, _estack;
+
+int main(void);
+void Reset_Handler(void);
+void SVC_Handler(void);
+void PendSV_Handler(void);
+void SysTick_Handler(void);
+void HardFault_Handler(void);
+
+static void TratadorPadrao(void)
+{
+	for(;;)
+	{
+	}
+}
+
+__attribute__ ((section(".vetores"), used))
+static void (* const vetores[16])(void) = 
+{
+	(void (*)(void))&_estack,	/* pilha inicial (MSP) */
+	Reset_Handler,
+	TratadorPadrao,				/* NMI */
+	HardFault_Handler,
+	0, 0, 0, 0, 0, 0, 0,		/* reservados */
+	SVC_Handler,
+	0, 0,						/* reservados */
+	PendSV_Handler,
+	SysTick_Handler,
+};
+
+void Reset_Handler(void)
+{
+	uint32_t *origem = &_sidata;
+	uint32_t *destino;
+	
+	for(destino = &_sdata; destino < &_edata; )
+	{
+		*destino++ = *origem++;
+	}
+	for(destino = &_sbss; destino < &_ebss; )
+	{
+		*destino++ = 0;
+	}
+	
+	main();
+	
+	for(;;)
+	{
+	}
+}
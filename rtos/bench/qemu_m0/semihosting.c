@@ -0,0 +1,52 @@
+/*
+ * semihosting.c
+ *
+ * Chamadas do semihosting (ARM) usadas pelos benchmarks.
+ */
+
+#include "semihosting.h"
+
+/* operacao em R0, argumento em R1 */
+#define SYS_WRITE0						0x04
+#define SYS_EXIT						0x18
+#define ADP_Stopped_ApplicationExit		0x20026
+#define ADP_Stopped_RunTimeErrorUnknown	0x20023
+
+static void Semihosting(uint32_t operacao, const void *argumento)
+{
+	register uint32_t r0 __asm("r0") = operacao;
+	register const void *r1 __asm("r1") = argumento;
+
+	__asm volatile("bkpt 0xAB" : "+r" (r0) : "r" (r1) : "memory");
+}
+
+void Escreve(const char *texto)
+{
+	Semihosting(SYS_WRITE0, texto);
+}
+
+void EscreveNumero(uint32_t valor)
+{
+	char texto[11];
+	char *p = &texto[10];
+
+	*p = '\0';
+	do
+	{
+		*--p = (char)('0' + valor % 10);
+		valor /= 10;
+	}while(valor != 0);
+
+	Escreve(p);
+}
+
+/* no AArch32 o motivo vai direto em R1; o QEMU termina com codigo 0 so para 
+   ADP_Stopped_ApplicationExit */
+void Termina(uint8_t sucesso)
+{
+	Semihosting(SYS_EXIT, (const void *)(sucesso ? ADP_Stopped_ApplicationExit : ADP_Stopped_RunTimeErrorUnknown));
+
+	for(;;)
+	{
+	}
+}
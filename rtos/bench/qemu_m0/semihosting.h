@@ -0,0 +1,17 @@
+/*
+ * semihosting.h
+ *
+ * Saida dos benchmarks pelo semihosting do ARM: o texto vai para o arquivo do
+ * chardev do QEMU (ver Makefile) e Termina encerra o QEMU.
+ */
+
+#ifndef SEMIHOSTING_H_
+#define SEMIHOSTING_H_
+
+#include <stdint.h>
+
+void Escreve(const char *texto);
+void EscreveNumero(uint32_t valor);
+void Termina(uint8_t sucesso);
+
+#endif /* SEMIHOSTING_H_ */
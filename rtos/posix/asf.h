@@ -0,0 +1,21 @@
+/*
+ * asf.h
+ *
+ * Substitui o asf.h do Atmel Software Framework na porta para Linux: so o
+ * LED da placa eh usado pelas tarefas de exemplo do main.c. Ver placa.c.
+ */
+
+#ifndef ASF_H_
+#define ASF_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* LED0 da placa SAM D21 Xplained Pro, aceso com nivel baixo */
+#define LED_0_PIN		0
+#define LED_0_ACTIVE	false
+
+void port_pin_set_output_level(const uint8_t gpio_pin, const bool level);
+void port_pin_toggle_output_level(const uint8_t gpio_pin);
+
+#endif /* ASF_H_ */
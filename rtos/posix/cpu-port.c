@@ -0,0 +1,479 @@
+/*
+ * cpu-port.c
+ *
+ * Porta do nucleo para Linux (POSIX). Ver cpu-port.h.
+ */
+
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cpu-port.h"
+#include "rtos.h"
+
+#if POSIX_MARCA_VIRTUAL && !cfg_MODO_SEM_MARCA_TEMPO
+#error "POSIX_MARCA_VIRTUAL: o tempo avanca quando a tarefa ociosa dorme, use cfg_MODO_SEM_MARCA_TEMPO = 1"
+#endif
+#if POSIX_MARCA_VIRTUAL && cfg_MIN_MARCAS_OCIOSAS > 1
+#error "POSIX_MARCA_VIRTUAL: com cfg_MIN_MARCAS_OCIOSAS > 1 a tarefa ociosa nao avancaria o tempo"
+#endif
+
+/* ponteiro de pilha da tarefa atual, escrito por TrocaContextoDasTarefas */
+extern stackptr_t SP;
+
+/* as trocas de contexto so acontecem depois que a primeira tarefa comecou */
+static volatile sig_atomic_t multitarefas_iniciado = 0;
+
+/* profundidade das rotinas de interrupcao em execucao e troca de contexto
+   pedida dentro delas, feita na saida como no PendSV */
+static volatile sig_atomic_t em_interrupcao = 0;
+static volatile sig_atomic_t troca_pendente = 0;
+
+static void (*rotina_interrupcao)(void) = NULL;
+
+#define PERIODO_MARCA_NS	(1000000000u / cfg_MARCA_TEMPO_HZ)
+
+#if !POSIX_MARCA_VIRTUAL
+static timer_t temporizador;
+
+/* instante (ns) em que a ultima marca de tempo contada deveria acontecer.
+   Avanca sempre de periodos inteiros, para que o atraso dos sinais e a
+   reprogramacao do temporizador no modo sem marca de tempo nao acumulem
+   diferenca entre o contador de marcas e o relogio */
+static volatile uint64_t instante_marca;
+
+static uint64_t Agora(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+}
+#endif
+
+static void Mascara(sigset_t *interrupcoes)
+{
+	sigemptyset(interrupcoes);
+	sigaddset(interrupcoes, SIGALRM);
+	sigaddset(interrupcoes, SIGUSR1);
+}
+
+static void MascaraInterrupcoes(int como)
+{
+	sigset_t interrupcoes;
+	Mascara(&interrupcoes);
+	sigprocmask(como, &interrupcoes, NULL);
+}
+
+void PosixDesabilitaInterrupcoes(void)
+{
+	MascaraInterrupcoes(SIG_BLOCK);
+}
+
+/* dentro de uma rotina de interrupcao os sinais continuam bloqueados ate o
+   fim dela: uma interrupcao nao interrompe outra */
+void PosixHabilitaInterrupcoes(void)
+{
+	if(!em_interrupcao)
+	{
+		MascaraInterrupcoes(SIG_UNBLOCK);
+	}
+}
+
+/* o contexto fica alinhado a 16 bytes dentro das TAM_CONTEXTO palavras
+   reservadas, entao o ponteiro de pilha pode ter qualquer alinhamento */
+static contexto_posix_t *Contexto(stackptr_t ptr_pilha)
+{
+	return (contexto_posix_t *)((uintptr_t)ptr_pilha & ~(uintptr_t)15);
+}
+
+/* primeira execucao de uma tarefa: SP ja aponta para o seu contexto. A
+   tarefa comeca com as interrupcoes bloqueadas, como todas as trocas de
+   contexto, e as habilita so aqui, ja na sua pilha */
+static void InicioTarefa(void)
+{
+	PosixHabilitaInterrupcoes();
+	Contexto(SP)->tarefa();
+	FimDeTarefa();			/* retorno da funcao da tarefa */
+}
+
+/* monta o contexto inicial em ptr_pilha, que esta TAM_CONTEXTO palavras
+   abaixo do fim da pilha de tamanho palavras; o restante da pilha eh o usado
+   pela tarefa */
+void PosixContextoInicial(stackptr_t ptr_pilha, void (*endereco_tarefa)(void), uint16_t tamanho)
+{
+	contexto_posix_t *contexto = Contexto(ptr_pilha);
+	char *base = (char *)(ptr_pilha + TAM_CONTEXTO - tamanho);
+
+	memset(contexto, 0, sizeof(contexto_posix_t));
+	getcontext(&contexto->contexto);
+	contexto->contexto.uc_stack.ss_sp = base;
+	contexto->contexto.uc_stack.ss_size = (size_t)((char *)contexto - base);
+	contexto->contexto.uc_link = NULL;
+	/* o swapcontext troca a mascara de sinais antes da pilha: com a mascara
+	   vazia, um sinal pendente seria atendido ainda na pilha da tarefa
+	   anterior, com SP ja na nova, e uma troca de contexto nessa rotina
+	   sobrescreveria o contexto inicial. A mascara so eh liberada em
+	   InicioTarefa */
+	Mascara(&contexto->contexto.uc_sigmask);
+	contexto->tarefa = endereco_tarefa;
+	makecontext(&contexto->contexto, InicioTarefa, 0);
+}
+
+stackptr_t CriaContexto(tarefa_t endereco_tarefa, stackptr_t ptr_pilha, uint16_t tamanho)
+{
+	ptr_pilha -= TAM_CONTEXTO;
+	PosixContextoInicial(ptr_pilha, endereco_tarefa, tamanho);
+	return ptr_pilha;
+}
+
+/* faz o papel do PendSV: deve ser chamada com as interrupcoes bloqueadas. O
+   contexto salvo guarda a mascara de sinais, entao a tarefa volta com elas
+   bloqueadas, seja na regiao atomica que pediu a troca, seja na rotina do
+   sinal que a interrompeu */
+static void ExecutaTrocaContexto(void)
+{
+	contexto_posix_t *anterior = Contexto(SP);
+
+	TrocaContextoDasTarefas();
+
+	if(Contexto(SP) != anterior)
+	{
+		swapcontext(&anterior->contexto, &Contexto(SP)->contexto);
+	}
+}
+
+void PosixTrocaContexto(void)
+{
+	if(em_interrupcao)
+	{
+		troca_pendente = 1;
+		return;
+	}
+	PosixDesabilitaInterrupcoes();
+	ExecutaTrocaContexto();
+	PosixHabilitaInterrupcoes();
+}
+
+/* faz o papel do SVC: comeca a primeira tarefa, nao retorna */
+void PosixIniciaPrimeiraTarefa(void)
+{
+	PosixDesabilitaInterrupcoes();
+	multitarefas_iniciado = 1;
+	troca_pendente = 0;
+	setcontext(&Contexto(SP)->contexto);
+	abort();
+}
+
+/* entrada e saida das rotinas de interrupcao, executadas com os sinais
+   bloqueados; a troca de contexto pedida na rotina eh feita na saida */
+static void EntraInterrupcao(void)
+{
+	em_interrupcao++;
+}
+
+static void SaiInterrupcao(void)
+{
+	em_interrupcao--;
+	if(em_interrupcao == 0 && troca_pendente && multitarefas_iniciado)
+	{
+		troca_pendente = 0;
+		ExecutaTrocaContexto();
+	}
+}
+
+uint32_t PosixCiclosDesdeMarca(void)
+{
+#if POSIX_MARCA_VIRTUAL
+	return 0;		/* o tempo virtual nao passa dentro de uma marca de tempo */
+#else
+	uint64_t decorrido = Agora() - instante_marca;
+	uint64_t ciclos = decorrido * (cfg_CPU_CLOCK_HZ / 1000000u) / 1000u;
+
+	/* o sinal pode atrasar: o contador nao passa do fim da marca de tempo */
+	if(ciclos >= CICLOS_POR_MARCA())
+	{
+		ciclos = CICLOS_POR_MARCA() - 1;
+	}
+	return (uint32_t)ciclos;
+#endif
+}
+
+uint8_t PosixMarcaPendente(void)
+{
+	sigset_t pendentes;
+	sigpending(&pendentes);
+	return (uint8_t)(sigismember(&pendentes, SIGALRM) == 1);
+}
+
+#if cfg_MEDE_MARCA_TEMPO
+/* duracao em ciclos (emulados) da ultima e da maior execucao da marca de tempo */
+volatile uint32_t ciclos_marca_tempo = 0;
+volatile uint32_t ciclos_marca_tempo_max = 0;
+#endif
+
+/* faz o papel do SysTick_Handler para qtas_marcas marcas de tempo: mais de
+   uma quando o sinal atrasou mais que um periodo */
+static void ExecutaMarcas(uint32_t qtas_marcas)
+{
+#if cfg_MEDE_MARCA_TEMPO && !POSIX_MARCA_VIRTUAL
+	uint64_t inicio = Agora();
+#endif
+
+#if !POSIX_MARCA_VIRTUAL
+	instante_marca += (uint64_t)qtas_marcas * PERIODO_MARCA_NS;
+#endif
+
+	for(; qtas_marcas > 0; qtas_marcas--)
+	{
+#if cfg_MODO_PREEMPTIVO
+		if(ExecutaMarcaDeTempo() && modo_preemptivo)
+		{
+			TROCA_CONTEXTO();
+		}
+#else
+		ExecutaMarcaDeTempo();
+#endif
+	}
+
+#if cfg_MEDE_MARCA_TEMPO && !POSIX_MARCA_VIRTUAL
+	ciclos_marca_tempo = (uint32_t)((Agora() - inicio) * (cfg_CPU_CLOCK_HZ / 1000000u) / 1000u);
+	if(ciclos_marca_tempo > ciclos_marca_tempo_max)
+	{
+		ciclos_marca_tempo_max = ciclos_marca_tempo;
+	}
+#endif
+}
+
+/* rotina do SIGALRM. Os sinais ficam bloqueados durante a rotina e voltam ao
+   valor anterior no retorno, quando a tarefa interrompida continuar */
+static void MarcaTempo(int sinal)
+{
+	uint32_t qtas_marcas = 1;
+
+	(void)sinal;
+
+#if !POSIX_MARCA_VIRTUAL
+	int atrasadas = timer_getoverrun(temporizador);
+	if(atrasadas > 0)
+	{
+		qtas_marcas += (uint32_t)atrasadas;
+	}
+#endif
+
+	EntraInterrupcao();
+	ExecutaMarcas(qtas_marcas);
+	SaiInterrupcao();
+}
+
+/* rotina do SIGUSR1: a interrupcao de periferico emulada */
+static void Interrupcao(int sinal)
+{
+	(void)sinal;
+
+	EntraInterrupcao();
+	if(rotina_interrupcao != NULL)
+	{
+		rotina_interrupcao();
+	}
+	SaiInterrupcao();
+}
+
+static void InstalaRotina(int sinal, void (*rotina)(int))
+{
+	struct sigaction acao;
+
+	memset(&acao, 0, sizeof(acao));
+	acao.sa_handler = rotina;
+	Mascara(&acao.sa_mask);		/* uma interrupcao nao interrompe a outra */
+	acao.sa_flags = SA_RESTART;
+	sigaction(sinal, &acao, NULL);
+}
+
+#if cfg_PERFIL > 0 && !POSIX_MARCA_VIRTUAL
+/* amostra do perfil, como a ENTRADA_PERFIL do Cortex-M0: o PC interrompido
+   vem do contexto que o Linux salvou para a rotina do sinal. O perfil guarda
+   32 bits do endereco, que so identificam a funcao em um executavel ligado
+   sem PIE (-no-pie) */
+static void MarcaTempoPerfil(int sinal, siginfo_t *info, void *contexto)
+{
+	ucontext_t *interrompido = contexto;
+
+	(void)info;
+#if defined(__x86_64__)
+	PerfilRegistra((uint32_t)interrompido->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__aarch64__)
+	PerfilRegistra((uint32_t)interrompido->uc_mcontext.pc);
+#else
+	(void)interrompido;
+	PerfilRegistra(0);
+#endif
+	MarcaTempo(sinal);
+}
+
+static void InstalaRotinaPerfil(void)
+{
+	struct sigaction acao;
+
+	memset(&acao, 0, sizeof(acao));
+	acao.sa_sigaction = MarcaTempoPerfil;
+	Mascara(&acao.sa_mask);
+	acao.sa_flags = SA_RESTART | SA_SIGINFO;
+	sigaction(SIGALRM, &acao, NULL);
+}
+#endif
+
+/* a rotina executa a cada SIGUSR1 (kill, raise ou um temporizador criado pela
+   aplicacao), com as interrupcoes desabilitadas, e pode chamar os servicos do
+   nucleo permitidos em interrupcoes */
+void PosixConfiguraInterrupcao(void (*rotina)(void))
+{
+	rotina_interrupcao = rotina;
+	InstalaRotina(SIGUSR1, Interrupcao);
+}
+
+#if POSIX_MARCA_VIRTUAL
+/* a tarefa atual trabalha durante qtas_marcas marcas de tempo: cada marca
+   eh executada como se a interrupcao chegasse, e pode trocar de contexto */
+void PosixAvancaMarcas(uint32_t qtas_marcas)
+{
+	for(; qtas_marcas > 0; qtas_marcas--)
+	{
+		PosixDesabilitaInterrupcoes();
+		MarcaTempo(SIGALRM);
+		PosixHabilitaInterrupcoes();
+	}
+}
+
+void ConfiguraMarcaTempo(void)
+{
+	InstalaRotina(SIGALRM, MarcaTempo);		/* so para raise(SIGALRM) */
+}
+#else
+/* a proxima marca de tempo acontece no instante absoluto primeira_ns e as
+   seguintes a cada periodo */
+static void ProgramaTemporizador(uint64_t primeira_ns)
+{
+	struct itimerspec valor;
+
+	valor.it_value.tv_sec = (time_t)(primeira_ns / 1000000000u);
+	valor.it_value.tv_nsec = (long)(primeira_ns % 1000000000u);
+	valor.it_interval.tv_sec = PERIODO_MARCA_NS / 1000000000u;
+	valor.it_interval.tv_nsec = PERIODO_MARCA_NS % 1000000000u;
+	timer_settime(temporizador, TIMER_ABSTIME, &valor, NULL);
+}
+
+/* instala a rotina do SIGALRM e inicia o temporizador periodico */
+void ConfiguraMarcaTempo(void)
+{
+	struct sigevent evento;
+
+#if cfg_PERFIL > 0
+	InstalaRotinaPerfil();
+#else
+	InstalaRotina(SIGALRM, MarcaTempo);
+#endif
+
+	memset(&evento, 0, sizeof(evento));
+	evento.sigev_notify = SIGEV_SIGNAL;
+	evento.sigev_signo = SIGALRM;
+	if(timer_create(CLOCK_MONOTONIC, &evento, &temporizador) != 0)
+	{
+		perror("timer_create");
+		abort();
+	}
+
+	instante_marca = Agora();
+	ProgramaTemporizador(instante_marca + PERIODO_MARCA_NS);
+}
+#endif
+
+#if cfg_MODO_SEM_MARCA_TEMPO
+#if POSIX_MARCA_VIRTUAL
+/* com o tempo virtual a tarefa ociosa salta direto para o proximo despertar.
+   Sem nenhuma tarefa na lista temporizada, nada mais vai acontecer */
+tick_t DormeMarcasDeTempo(tick_t qtas_marcas)
+{
+	if(qtas_marcas == (tick_t)~(tick_t)0)
+	{
+		fprintf(stderr, "tempo virtual: todas as tarefas esperam sem tempo limite\n");
+		abort();
+	}
+	return qtas_marcas;
+}
+#else
+/* modo sem marca de tempo: programa o temporizador para a fronteira da marca
+   de tempo qtas_marcas e espera com sigwait, que consome o sinal sem executar
+   a rotina. Chamada com as interrupcoes desabilitadas. Se o SIGUSR1 acordar
+   o processo antes, so as marcas inteiras que passaram sao contadas, o
+   temporizador volta a ser periodico a partir da proxima e o SIGUSR1 fica
+   pendente, para ser atendido no fim da regiao atomica */
+tick_t DormeMarcasDeTempo(tick_t qtas_marcas)
+{
+	sigset_t interrupcoes;
+	tick_t passadas;
+	int sinal;
+	int atrasadas;
+
+#if cfg_MARCA_TEMPO_64BITS
+	if(qtas_marcas > 0xFFFFFFFFu)
+	{
+		qtas_marcas = 0xFFFFFFFFu;
+	}
+#endif
+
+	if(PosixMarcaPendente())
+	{
+		return 0;		/* uma marca de tempo ja esta pendente: nao dorme */
+	}
+
+	ProgramaTemporizador(instante_marca + (uint64_t)qtas_marcas * PERIODO_MARCA_NS);
+
+	Mascara(&interrupcoes);
+	sigwait(&interrupcoes, &sinal);
+
+	if(sinal == SIGALRM)
+	{
+		/* todas passaram; o temporizador continua periodico a partir daqui */
+		passadas = qtas_marcas;
+		atrasadas = timer_getoverrun(temporizador);
+		if(atrasadas > 0)
+		{
+			passadas += (tick_t)atrasadas;
+		}
+	}else
+	{
+		raise(sinal);
+		if(PosixMarcaPendente())
+		{
+			/* o temporizador tambem disparou: a sua rotina conta a ultima */
+			passadas = qtas_marcas - 1;
+		}else
+		{
+			passadas = (tick_t)((Agora() - instante_marca) / PERIODO_MARCA_NS);
+			if(passadas >= qtas_marcas)
+			{
+				passadas = qtas_marcas - 1;	/* o sinal da ultima esta chegando */
+			}
+			ProgramaTemporizador(instante_marca + (uint64_t)(passadas + 1) * PERIODO_MARCA_NS);
+		}
+	}
+
+	instante_marca += (uint64_t)passadas * PERIODO_MARCA_NS;
+
+	return passadas;
+}
+#endif
+#endif
+
+#if cfg_VERIFICA_PILHA
+/* no computador o estouro de pilha termina o processo com uma mensagem. Fraca,
+   como a do nucleo, para que um teste possa redefini-la; vem antes do rtos.c
+   na ligacao e substitui a dele */
+__attribute__((weak)) void EstouroDePilha(id_tarefa_t id_tarefa)
+{
+	fprintf(stderr, "estouro de pilha da tarefa %u\n", (unsigned)id_tarefa);
+	abort();
+}
+#endif
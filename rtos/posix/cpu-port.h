@@ -0,0 +1,91 @@
+/*
+ * cpu-port.h
+ *
+ * Porta do nucleo para Linux (POSIX): o nucleo e as tarefas executam como um
+ * processo comum, em uma so thread. Cada tarefa tem um contexto ucontext_t,
+ * guardado no topo da sua propria pilha, e a marca de tempo eh o sinal SIGALRM
+ * de um temporizador periodico (timer_create). O SIGUSR1 faz o papel de uma
+ * interrupcao de periferico (PosixConfiguraInterrupcao). Bloquear os dois
+ * sinais faz o papel de desabilitar as interrupcoes e as rotinas dos sinais
+ * fazem o papel das interrupcoes e do PendSV.
+ *
+ * Com POSIX_MARCA_VIRTUAL = 1 nao ha temporizador: o tempo so avanca quando
+ * uma tarefa chama PosixAvancaMarcas, que simula o trabalho feito durante
+ * algumas marcas de tempo, e quando a tarefa ociosa dorme, que salta direto
+ * para o proximo despertar. Os testes ficam deterministicos e rapidos. Exige
+ * o modo sem marca de tempo com cfg_MIN_MARCAS_OCIOSAS = 1.
+ *
+ * Com cfg_PERFIL, em tempo real, a rotina do SIGALRM tambem guarda no perfil
+ * o PC da tarefa interrompida, como o SysTick do Cortex-M0.
+ */
+
+#ifndef CPU_PORT_H_
+#define CPU_PORT_H_
+
+#include <stdint.h>
+#include <ucontext.h>
+
+/* a pilha de uma tarefa tambem recebe o quadro do sinal da marca de tempo e
+   as chamadas da biblioteca C, bem maiores que no Cortex-M0 */
+#ifndef TAM_MINIMO_PILHA
+#define TAM_MINIMO_PILHA	(8192)
+#endif
+
+#ifndef POSIX_MARCA_VIRTUAL
+#define POSIX_MARCA_VIRTUAL	0
+#endif
+
+/* tipo do ponteiro de pilha */
+typedef uint32_t* stackptr_t;
+
+/**
+* \struct contexto_posix_t
+* Contexto de uma tarefa, no topo da sua pilha. O ponteiro de pilha da tarefa
+* (stack_pointer no TCB e SP) aponta para ele.
+*/
+
+typedef struct
+{
+	ucontext_t	contexto;			///< Registradores e mascara de sinais salvos
+	void		(*tarefa)(void);	///< Funcao executada na primeira vez
+} contexto_posix_t;
+
+/* com a tabela estatica as pilhas sao declaradas pelo sistema, com
+   TAM_CONTEXTO palavras reservadas para o contexto inicial */
+#define TAM_CONTEXTO		((sizeof(contexto_posix_t) + 15) / sizeof(uint32_t))
+#define CONTEXTO_INICIAL(ptr_pilha, endereco_tarefa, tamanho)	\
+	PosixContextoInicial((ptr_pilha), (endereco_tarefa), (tamanho))
+
+void PosixContextoInicial(stackptr_t ptr_pilha, void (*endereco_tarefa)(void), uint16_t tamanho);
+void PosixDesabilitaInterrupcoes(void);
+void PosixHabilitaInterrupcoes(void);
+void PosixTrocaContexto(void);
+void PosixIniciaPrimeiraTarefa(void);
+uint32_t PosixCiclosDesdeMarca(void);
+uint8_t PosixMarcaPendente(void);
+void PosixConfiguraInterrupcao(void (*rotina)(void));
+#if POSIX_MARCA_VIRTUAL
+void PosixAvancaMarcas(uint32_t qtas_marcas);
+#endif
+
+/* regioes atomicas: os sinais ficam bloqueados e, se chegarem, ficam
+   pendentes ate o fim da regiao, como interrupcoes com o PRIMASK ligado */
+#define REG_ATOMICA_INICIO()	PosixDesabilitaInterrupcoes();
+#define REG_ATOMICA_FIM()		PosixHabilitaInterrupcoes();
+
+/* como no Cortex-M0, a troca de contexto reabilita as interrupcoes. Dentro
+   de uma interrupcao ela so fica pendente, como o PendSV, ate o fim da rotina */
+#define TROCA_CONTEXTO()		PosixTrocaContexto();
+#define TrocaContexto()			TROCA_CONTEXTO()
+
+/* contador de ciclos emulado com o relogio do computador, na frequencia
+   cfg_CPU_CLOCK_HZ, zerado a cada marca de tempo como o SysTick */
+#define CICLOS_POR_MARCA()		(cfg_CPU_CLOCK_HZ / cfg_MARCA_TEMPO_HZ)
+#define CICLOS_DESDE_MARCA()	PosixCiclosDesdeMarca()
+#define MARCA_TEMPO_PENDENTE()	PosixMarcaPendente()
+
+#define BARREIRA_MEMORIA()		__asm volatile("" ::: "memory");
+
+#define GERA_INTERRUPCAO_SW()	PosixIniciaPrimeiraTarefa();
+
+#endif /* CPU_PORT_H_ */
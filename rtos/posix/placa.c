@@ -0,0 +1,39 @@
+/*
+ * placa.c
+ *
+ * LED da placa na porta para Linux: cada mudanca do LED eh escrita na saida
+ * padrao com a marca de tempo em que aconteceu.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <asf.h>
+#include "rtos.h"
+
+static bool nivel_led = !LED_0_ACTIVE;
+
+/* write, e nao printf, porque a tarefa pode ser interrompida no meio da
+   escrita por outra que tambem escreve */
+static void MostraLED(void)
+{
+	char linha[48];
+	int tamanho = snprintf(linha, sizeof(linha), "marca %lu: LED %s\n",
+		(unsigned long)ObtemMarcaDeTempo(), (nivel_led == LED_0_ACTIVE) ? "aceso" : "apagado");
+
+	ssize_t escritos = write(STDOUT_FILENO, linha, (size_t)tamanho);
+	(void)escritos;
+}
+
+void port_pin_set_output_level(const uint8_t gpio_pin, const bool level)
+{
+	(void)gpio_pin;
+	nivel_led = level;
+	MostraLED();
+}
+
+void port_pin_toggle_output_level(const uint8_t gpio_pin)
+{
+	(void)gpio_pin;
+	nivel_led = !nivel_led;
+	MostraLED();
+}
@@ -0,0 +1,38 @@
+/*
+ * teste.h
+ *
+ * Verificacoes dos testes da porta para Linux (make test). Cada teste eh um
+ * programa com as suas tarefas; uma falha termina o processo com codigo 1 e
+ * o teste passa quando uma das tarefas chama exit(0).
+ */
+
+#ifndef TESTE_H_
+#define TESTE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define VERIFICA(condicao)															\
+	do{																				\
+		if(!(condicao))																\
+		{																			\
+			fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #condicao);	\
+			exit(1);																\
+		}																			\
+	}while(0)
+
+/* gerador pseudoaleatorio (xorshift32) com semente fixa, para que as falhas
+   se repitam; nao usa o rand da biblioteca C, que tem trava e nao pode ser
+   chamado por duas tarefas que se interrompem */
+static uint32_t semente_teste = 2463534242u;
+
+static inline uint32_t Aleatorio(uint32_t limite)
+{
+	semente_teste ^= semente_teste << 13;
+	semente_teste ^= semente_teste >> 17;
+	semente_teste ^= semente_teste << 5;
+	return semente_teste % limite;
+}
+
+#endif /* TESTE_H_ */
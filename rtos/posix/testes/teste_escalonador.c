@@ -0,0 +1,147 @@
+/*
+ * teste_escalonador.c
+ *
+ * Compara o escalonador com mapa de bits com a busca linear do escalonador
+ * original, que percorria as prioridades da maior para a menor ate achar uma
+ * tarefa pronta. A tarefa de controle, de maior prioridade, suspende e
+ * continua tarefas ao acaso e dorme uma marca de tempo; a tarefa que executa
+ * nessa marca deve ter a prioridade escolhida pela busca linear sobre os
+ * estados dos TCBs e pelo modelo que a tarefa de controle mantem.
+ */
+
+#include "rtos.h"
+#include "teste.h"
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+#define TRABALHADORAS	8
+#define RODADAS			20000
+
+/* duas ou tres tarefas por prioridade, para exercitar as filas circulares */
+static const prioridade_t prioridades[TRABALHADORAS] = {1, 1, 2, 2, 2, 3, 3, 1};
+
+static uint32_t pilha_controle[TAM_PILHA];
+static uint32_t pilhas[TRABALHADORAS][TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static id_tarefa_t ids[TRABALHADORAS];
+static uint8_t suspensa[TRABALHADORAS];
+static uint32_t execucoes[TRABALHADORAS];
+static volatile id_tarefa_t executou;
+
+/* o escalonador original: a maior prioridade com alguma tarefa pronta,
+   procurada nos estados dos TCBs, abaixo da tarefa de controle (0 = nenhuma,
+   executa a ociosa) */
+static prioridade_t EscalonadorLinear(void)
+{
+	prioridade_t prioridade;
+	uint8_t i;
+
+	for(prioridade = PRIORIDADE_MAXIMA - 1; prioridade > 0; prioridade--)
+	{
+		for(i = 0; i < TRABALHADORAS; i++)
+		{
+			if(TCB[ids[i]].prioridade == prioridade && TCB[ids[i]].estado == PRONTA)
+			{
+				return prioridade;
+			}
+		}
+	}
+	return 0;
+}
+
+/* a mesma escolha feita sobre o modelo, sem olhar o nucleo */
+static prioridade_t EscalonadorModelo(void)
+{
+	prioridade_t maior = 0;
+	uint8_t i;
+
+	for(i = 0; i < TRABALHADORAS; i++)
+	{
+		if(!suspensa[i] && prioridades[i] > maior)
+		{
+			maior = prioridades[i];
+		}
+	}
+	return maior;
+}
+
+static void trabalhadora(void)
+{
+	for(;;)
+	{
+		executou = tarefa_atual;
+		PosixAvancaMarcas(1);
+	}
+}
+
+static void controle(void)
+{
+	uint32_t rodada, i, ocupadas = 0;
+	uint8_t operacoes, t;
+	prioridade_t esperada;
+
+	for(rodada = 0; rodada < RODADAS; rodada++)
+	{
+		for(operacoes = (uint8_t)(1 + Aleatorio(3)); operacoes > 0; operacoes--)
+		{
+			t = (uint8_t)Aleatorio(TRABALHADORAS);
+			if(suspensa[t])
+			{
+				VERIFICA(TarefaContinua(ids[t]) == SUCESSO);
+			}else
+			{
+				VERIFICA(TarefaSuspende(ids[t]) == SUCESSO);
+			}
+			suspensa[t] = !suspensa[t];
+		}
+
+		esperada = EscalonadorLinear();
+		VERIFICA(esperada == EscalonadorModelo());
+
+		executou = 0;
+		TarefaEspera(1);
+
+		if(esperada == 0)
+		{
+			VERIFICA(executou == 0);		/* so a ociosa estava pronta */
+		}else
+		{
+			VERIFICA(executou != 0);
+			VERIFICA(TCB[executou].prioridade == esperada);
+			for(t = 0; ids[t] != executou; t++)
+			{
+			}
+			VERIFICA(!suspensa[t]);
+			execucoes[t]++;
+			ocupadas++;
+		}
+	}
+
+	/* todas as trabalhadoras executaram, inclusive as de mesma prioridade */
+	for(i = 0; i < TRABALHADORAS; i++)
+	{
+		VERIFICA(execucoes[i] > 0);
+	}
+
+	printf("escalonador: %u rodadas (%u com trabalhadora pronta) iguais a busca linear\n",
+		(unsigned)RODADAS, (unsigned)ocupadas);
+	exit(0);
+}
+
+int main(void)
+{
+	uint8_t i;
+
+	CriaTarefa(controle, "controle", pilha_controle, TAM_PILHA, PRIORIDADE_MAXIMA);
+	for(i = 0; i < TRABALHADORAS; i++)
+	{
+		CriaTarefa(trabalhadora, "trabalhadora", pilhas[i], TAM_PILHA, prioridades[i]);
+		ids[i] = (id_tarefa_t)(i + 2);		/* os ids seguem a ordem de criacao */
+	}
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
@@ -0,0 +1,89 @@
+/*
+ * teste_espera_ate.c
+ *
+ * Tarefa periodica com TarefaEsperaAte por PERIODOS periodos, com o tempo
+ * virtual: a cada periodo ela trabalha 0 ou 1 marca de tempo e uma tarefa de
+ * maior prioridade, que acorda ao acaso, a atrasa em ate 2 marcas. O contador
+ * comeca perto do maximo (cfg_MARCA_TEMPO_INICIAL) e da a volta durante o
+ * teste. O atraso de cada liberacao (jitter) fica limitado pela interferencia
+ * e nao se acumula: no fim, os despertares estao exatamente em
+ * inicio + PERIODOS * PERIODO.
+ */
+
+#include "rtos.h"
+#include "teste.h"
+
+#define TAM_PILHA			(TAM_MINIMO_PILHA + 24)
+#ifndef PERIODOS
+#define PERIODOS			1000000u
+#endif
+#define PERIODO				5
+#define INTERFERENCIA_MAX	2
+
+static uint32_t pilha_periodica[TAM_PILHA];
+static uint32_t pilha_interferencia[TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static void periodica(void)
+{
+	tick_t ultimo = ObtemMarcaDeTempo();
+	tick_t inicio = ultimo;
+	tick_t anterior = ultimo;
+	tick_t agora, atraso, atraso_max = 0;
+	uint64_t atraso_soma = 0;
+	uint32_t periodo, voltas = 0;
+
+	for(periodo = 1; periodo <= PERIODOS; periodo++)
+	{
+		TarefaEsperaAte(&ultimo, PERIODO);
+
+		/* atraso da liberacao em relacao ao instante ideal, em aritmetica 
+		   modular como no nucleo */
+		agora = ObtemMarcaDeTempo();
+		atraso = agora - ultimo;
+		VERIFICA(atraso <= INTERFERENCIA_MAX);
+		if(atraso > atraso_max)
+		{
+			atraso_max = atraso;
+		}
+		atraso_soma += atraso;
+		if(agora < anterior)
+		{
+			voltas++;
+		}
+		anterior = agora;
+
+		PosixAvancaMarcas(Aleatorio(2));
+	}
+
+	/* nenhuma deriva acumulada: o ultimo despertar eh o ideal */
+	VERIFICA(ultimo == (tick_t)(inicio + (tick_t)PERIODOS * PERIODO));
+	VERIFICA(voltas >= 1);
+
+	printf("espera ate: %u periodos de %u marcas, jitter maximo %u marcas (medio %.3f), "
+		"deriva 0, %u volta(s) do contador\n",
+		(unsigned)PERIODOS, (unsigned)PERIODO, (unsigned)atraso_max,
+		(double)atraso_soma / PERIODOS, (unsigned)voltas);
+	exit(0);
+}
+
+static void interferencia(void)
+{
+	for(;;)
+	{
+		TarefaEspera(7 + Aleatorio(14));
+		PosixAvancaMarcas(Aleatorio(INTERFERENCIA_MAX + 1));
+	}
+}
+
+int main(void)
+{
+	CriaTarefa(interferencia, "interferencia", pilha_interferencia, TAM_PILHA, 3);
+	CriaTarefa(periodica, "periodica", pilha_periodica, TAM_PILHA, 2);
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
@@ -0,0 +1,153 @@
+/*
+ * teste_eventos.c
+ *
+ * Grupo de eventos, com o tempo virtual. A tarefa de controle, de maior
+ * prioridade, poe tres trabalhadoras (prioridades 1 a 3) para esperar por
+ * combinacoes de eventos e verifica:
+ *  - esperas por qualquer e por todos na mesma fila;
+ *  - a tarefa satisfeita atras de outras nao satisfeitas eh acordada na mesma
+ *    passada de EventosSinaliza, e as outras continuam esperando;
+ *  - todas as acordadas na mesma sinalizacao veem os mesmos eventos, e os de
+ *    EVENTOS_LIMPA so sao limpos depois da passada;
+ *  - os tempos limite, exatos em marcas de tempo, e a espera sem tempo.
+ */
+
+#include "rtos.h"
+#include "teste.h"
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+
+#define TRABALHADORAS	3			/* trabalhadora i tem prioridade i + 1 */
+#define CONTROLE		4
+
+static uint32_t pilha_controle[TAM_PILHA];
+static uint32_t pilhas_trabalhadoras[TRABALHADORAS][TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static grupo_eventos_t grupo = {0, 0};
+
+/* comando e resultado de cada trabalhadora */
+static semaforo_t partida[TRABALHADORAS];
+static uint32_t eventos[TRABALHADORAS];
+static uint8_t opcoes[TRABALHADORAS];
+static tick_t tempo[TRABALHADORAS];
+static resultado_t resultado[TRABALHADORAS];
+static uint32_t obtidos[TRABALHADORAS];
+static tick_t fim[TRABALHADORAS];
+static uint32_t concluidas[TRABALHADORAS];
+
+static void trabalhadora(void)
+{
+	uint32_t i = TCB[tarefa_atual].prioridade - 1;
+
+	for(;;)
+	{
+		SemaforoAguarda(&partida[i]);
+		resultado[i] = EventosAguarda(&grupo, eventos[i], opcoes[i], &obtidos[i], tempo[i]);
+		fim[i] = ObtemMarcaDeTempo();
+		concluidas[i]++;
+	}
+}
+
+/* a trabalhadora i comeca a esperar quando a de controle dormir, ainda na
+   mesma marca de tempo */
+static void Aguarda(uint32_t i, uint32_t e, uint8_t o, tick_t t)
+{
+	eventos[i] = e;
+	opcoes[i] = o;
+	tempo[i] = t;
+	obtidos[i] = 0;
+	SemaforoLibera(&partida[i]);
+}
+
+static void controle(void)
+{
+	uint32_t bits;
+	tick_t inicio;
+
+	/* fila de espera, em ordem de prioridade: todos 0x03, todos 0x0C com
+	   limpeza, qualquer de 0x01 com limpeza */
+	Aguarda(2, 0x03, EVENTOS_TODOS, ESPERA_INFINITA);
+	Aguarda(1, 0x0C, EVENTOS_TODOS | EVENTOS_LIMPA, ESPERA_INFINITA);
+	Aguarda(0, 0x01, EVENTOS_QUALQUER | EVENTOS_LIMPA, ESPERA_INFINITA);
+	TarefaEspera(1);
+	VERIFICA(concluidas[0] == 0 && concluidas[1] == 0 && concluidas[2] == 0);
+
+	/* so a ultima da fila eh satisfeita e limpa o seu evento */
+	EventosSinaliza(&grupo, 0x01);
+	VERIFICA(TCB[grupo.fila_espera].prioridade == 3);
+	VERIFICA(TCB[TCB[grupo.fila_espera].proxima].prioridade == 2);
+	VERIFICA(grupo.bits == 0);
+	TarefaEspera(1);
+	VERIFICA(concluidas[0] == 1 && resultado[0] == SUCESSO && obtidos[0] == 0x01);
+	VERIFICA(concluidas[1] == 0 && concluidas[2] == 0);
+
+	/* parte de cada conjunto: ninguem acorda */
+	EventosSinaliza(&grupo, 0x06);
+	TarefaEspera(1);
+	VERIFICA(concluidas[1] == 0 && concluidas[2] == 0 && grupo.bits == 0x06);
+
+	/* completa os dois conjuntos: as duas acordam com os mesmos eventos, e so
+	   os da que pediu limpeza sao limpos, depois de avaliadas as duas */
+	EventosSinaliza(&grupo, 0x09);
+	VERIFICA(grupo.fila_espera == 0);
+	VERIFICA(grupo.bits == 0x03);
+	TarefaEspera(1);
+	VERIFICA(concluidas[1] == 1 && resultado[1] == SUCESSO && obtidos[1] == 0x0F);
+	VERIFICA(concluidas[2] == 1 && resultado[2] == SUCESSO && obtidos[2] == 0x0F);
+
+	/* espera ja satisfeita: retorna sem bloquear e limpa os pedidos */
+	VERIFICA(EventosAguarda(&grupo, 0x03, EVENTOS_TODOS | EVENTOS_LIMPA, &bits, 0) == SUCESSO);
+	VERIFICA(bits == 0x03 && grupo.bits == 0);
+
+	/* sem tempo de espera: falha na hora, com os eventos atuais */
+	EventosSinaliza(&grupo, 0x10);
+	VERIFICA(EventosAguarda(&grupo, 0x30, EVENTOS_TODOS, &bits, 0) == TEMPO_ESGOTADO);
+	VERIFICA(bits == 0x10 && grupo.bits == 0x10);
+
+	/* tempos limite: as esperas terminam nas marcas pedidas, mesmo com
+	   sinalizacoes que nao as satisfazem, e saem da fila */
+	inicio = ObtemMarcaDeTempo();
+	Aguarda(0, 0x30, EVENTOS_TODOS, 5);
+	Aguarda(1, 0x40, EVENTOS_QUALQUER, 3);
+	Aguarda(2, 0x80, EVENTOS_QUALQUER, ESPERA_INFINITA);
+	TarefaEspera(1);
+	EventosSinaliza(&grupo, 0x01);
+	TarefaEspera(6);
+	VERIFICA(concluidas[0] == 2 && resultado[0] == TEMPO_ESGOTADO && fim[0] - inicio == 5);
+	VERIFICA(concluidas[1] == 2 && resultado[1] == TEMPO_ESGOTADO && fim[1] - inicio == 3);
+	VERIFICA(obtidos[0] == 0x11 && obtidos[1] == 0x11);
+	VERIFICA(concluidas[2] == 1);
+	VERIFICA(grupo.fila_espera != 0 && TCB[grupo.fila_espera].prioridade == 3);
+	VERIFICA(TCB[grupo.fila_espera].proxima == grupo.fila_espera);
+
+	/* a que restou acorda antes de qualquer tempo limite */
+	EventosSinaliza(&grupo, 0x80);
+	TarefaEspera(1);
+	VERIFICA(concluidas[2] == 2 && resultado[2] == SUCESSO && obtidos[2] == 0x91);
+	VERIFICA(grupo.fila_espera == 0);
+
+	EventosLimpa(&grupo, 0xFF);
+	VERIFICA(grupo.bits == 0);
+
+	printf("eventos: qualquer/todos na mesma fila, satisfeita atras de nao "
+		"satisfeitas, limpeza depois da passada e tempos limite ok\n");
+	exit(0);
+}
+
+int main(void)
+{
+	uint32_t i;
+
+	CriaTarefa(controle, "controle", pilha_controle, TAM_PILHA, CONTROLE);
+	for(i = 0; i < TRABALHADORAS; i++)
+	{
+		CriaTarefa(trabalhadora, "trabalhadora", pilhas_trabalhadoras[i], TAM_PILHA, i + 1);
+	}
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
@@ -0,0 +1,89 @@
+/*
+ * teste_fatia.c
+ *
+ * Fatia de tempo entre tarefas de mesma prioridade, com o tempo virtual. Duas
+ * tarefas que so calculam dividem o processador com uma tarefa de maior
+ * prioridade que as interrompe a cada 3 marcas de tempo, mais vezes que a
+ * fatia (cfg_QUANTUM_MARCAS). A preempcao nao pode renovar a fatia da tarefa
+ * interrompida, senao a outra nunca executaria. Mede as trocas de contexto a
+ * mais causadas pela fatia, por segundo, e verifica que no modo cooperativo
+ * elas nao sao contadas.
+ */
+
+#include "rtos.h"
+#include "teste.h"
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+#define MARCAS			100000
+#define PERIODO_ALTA	3
+
+static uint32_t pilha_alta[TAM_PILHA];
+static uint32_t pilhas_iguais[2][TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static volatile uint32_t trabalho[2];
+
+static void igual(void)
+{
+	uint8_t indice = (uint8_t)(tarefa_atual - 2);
+
+	for(;;)
+	{
+		PosixAvancaMarcas(1);
+		trabalho[indice]++;
+		if(!modo_preemptivo)
+		{
+			TrocaContexto();		/* no modo cooperativo as tarefas cedem a vez */
+		}
+	}
+}
+
+static void alta(void)
+{
+	tick_t ultimo = ObtemMarcaDeTempo();
+	tick_t inicio = ultimo;
+	uint32_t trocas, total;
+
+	while(ObtemMarcaDeTempo() - inicio < MARCAS)
+	{
+		TarefaEsperaAte(&ultimo, PERIODO_ALTA);
+		PosixAvancaMarcas(1);
+	}
+
+	/* as duas tarefas de mesma prioridade dividem o que sobra */
+	total = trabalho[0] + trabalho[1];
+	VERIFICA(total > MARCAS / 2);
+	VERIFICA(trabalho[0] > total * 4 / 10 && trabalho[1] > total * 4 / 10);
+
+	/* uma troca a cada fatia completa das tarefas de mesma prioridade */
+	trocas = trocas_por_fatia;
+	VERIFICA(trocas >= total / cfg_QUANTUM_MARCAS - 2 && trocas <= total / cfg_QUANTUM_MARCAS + 2);
+
+	printf("fatia: %u marcas, divisao %u/%u, %u trocas por fatia = %.1f por segundo a %u Hz (quantum %u)\n",
+		(unsigned)MARCAS, (unsigned)trabalho[0], (unsigned)trabalho[1], (unsigned)trocas,
+		(double)trocas * cfg_MARCA_TEMPO_HZ / MARCAS, (unsigned)cfg_MARCA_TEMPO_HZ, (unsigned)cfg_QUANTUM_MARCAS);
+
+	/* no modo cooperativo a marca de tempo nao troca de contexto */
+	ConfiguraModoPreemptivo(0);
+	inicio = ObtemMarcaDeTempo();
+	while(ObtemMarcaDeTempo() - inicio < 1000)
+	{
+		TarefaEspera(PERIODO_ALTA);
+	}
+	VERIFICA(trocas_por_fatia == trocas);
+
+	exit(0);
+}
+
+int main(void)
+{
+	CriaTarefa(alta, "alta", pilha_alta, TAM_PILHA, 3);
+	CriaTarefa(igual, "igual 1", pilhas_iguais[0], TAM_PILHA, 1);	/* ids 2 e 3 */
+	CriaTarefa(igual, "igual 2", pilhas_iguais[1], TAM_PILHA, 1);
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
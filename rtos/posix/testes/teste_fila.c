@@ -0,0 +1,227 @@
+/*
+ * teste_fila.c
+ *
+ * Fila de mensagens, com o tempo virtual. A tarefa de controle, de maior
+ * prioridade, comanda tres trabalhadoras (prioridades 1 a 3), que so executam
+ * quando ela dorme, e verifica:
+ *  - a entrega direta a uma receptora bloqueada, sem passar pela area;
+ *  - a remetente bloqueada na fila cheia, cujo item entra no espaco liberado;
+ *  - os tempos limite de envio e de recepcao, exatos em marcas de tempo;
+ *  - o modo ponteiro: o receptor recebe o endereco da mensagem, sem copia;
+ *  - a ordem de prioridade entre as tarefas esperando, para receber e enviar.
+ */
+
+#include "rtos.h"
+#include "teste.h"
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+
+#define TRABALHADORAS	3			/* trabalhadora i tem prioridade i + 1 */
+#define CONTROLE		4
+#define CAPACIDADE		2
+
+typedef enum {RECEBE, ENVIA, RECEBE_PONTEIRO} comando_t;
+
+static uint32_t pilha_controle[TAM_PILHA];
+static uint32_t pilhas_trabalhadoras[TRABALHADORAS][TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static uint32_t area[CAPACIDADE];
+static fila_mensagens_t fila = FILA_MENSAGENS_INICIALIZADOR(area, sizeof(uint32_t), CAPACIDADE);
+static void *area_ponteiros[CAPACIDADE];
+static fila_mensagens_t fila_ponteiros = FILA_MENSAGENS_INICIALIZADOR(area_ponteiros, sizeof(void *), CAPACIDADE);
+
+static uint8_t mensagens[2][64];
+
+/* comando e resultado de cada trabalhadora */
+static semaforo_t partida[TRABALHADORAS];
+static comando_t comando[TRABALHADORAS];
+static tick_t tempo[TRABALHADORAS];
+static uint32_t valor[TRABALHADORAS];
+static void *ponteiro[TRABALHADORAS];
+static resultado_t resultado[TRABALHADORAS];
+static tick_t fim[TRABALHADORAS];
+static uint32_t concluidas[TRABALHADORAS];
+
+static void trabalhadora(void)
+{
+	uint32_t i = TCB[tarefa_atual].prioridade - 1;
+
+	for(;;)
+	{
+		SemaforoAguarda(&partida[i]);
+		switch(comando[i])
+		{
+			case RECEBE:
+				resultado[i] = FilaRecebe(&fila, &valor[i], tempo[i]);
+				break;
+			case ENVIA:
+				resultado[i] = FilaEnvia(&fila, &valor[i], tempo[i]);
+				break;
+			case RECEBE_PONTEIRO:
+				resultado[i] = FilaRecebePonteiro(&fila_ponteiros, &ponteiro[i], tempo[i]);
+				break;
+		}
+		fim[i] = ObtemMarcaDeTempo();
+		concluidas[i]++;
+	}
+}
+
+/* a trabalhadora i executa o comando quando a de controle dormir, ainda na
+   mesma marca de tempo */
+static void Comanda(uint32_t i, comando_t c, uint32_t v, tick_t t)
+{
+	comando[i] = c;
+	valor[i] = v;
+	tempo[i] = t;
+	SemaforoLibera(&partida[i]);
+}
+
+static uint32_t Recebe(void)
+{
+	uint32_t item = 0;
+	VERIFICA(FilaRecebe(&fila, &item, 0) == SUCESSO);
+	return item;
+}
+
+static void Envia(uint32_t item)
+{
+	VERIFICA(FilaEnvia(&fila, &item, 0) == SUCESSO);
+}
+
+static void controle(void)
+{
+	uint32_t item, i;
+	tick_t inicio;
+	void *p;
+
+	/* entrega direta: a receptora ja tem o item antes de executar, e a area
+	   continua vazia */
+	Comanda(2, RECEBE, 0, ESPERA_INFINITA);
+	TarefaEspera(1);
+	VERIFICA(fila.fila_recepcao != 0 && concluidas[2] == 0);
+	inicio = fila.inicio;
+	Envia(0x11111111u);
+	VERIFICA(fila.quantidade == 0 && fila.inicio == inicio && fila.fila_recepcao == 0);
+	VERIFICA(valor[2] == 0x11111111u);
+	TarefaEspera(1);
+	VERIFICA(concluidas[2] == 1 && resultado[2] == SUCESSO);
+
+	/* fila cheia: envio sem espera falha, a remetente bloqueia e o seu item
+	   ocupa o espaco liberado pela primeira recepcao */
+	Envia(1);
+	Envia(2);
+	item = 3;
+	VERIFICA(FilaEnvia(&fila, &item, 0) == TEMPO_ESGOTADO);
+	VERIFICA(fila.quantidade == CAPACIDADE);
+	Comanda(2, ENVIA, 3, ESPERA_INFINITA);
+	TarefaEspera(1);
+	VERIFICA(fila.fila_envio != 0 && concluidas[2] == 1);
+	VERIFICA(Recebe() == 1);
+	VERIFICA(fila.quantidade == CAPACIDADE && fila.fila_envio == 0);
+	VERIFICA(Recebe() == 2);
+	VERIFICA(Recebe() == 3);
+	VERIFICA(FilaRecebe(&fila, &item, 0) == TEMPO_ESGOTADO);
+	TarefaEspera(1);
+	VERIFICA(concluidas[2] == 2 && resultado[2] == SUCESSO);
+
+	/* tempos limite exatos; a fila nao muda */
+	inicio = ObtemMarcaDeTempo();
+	VERIFICA(FilaRecebe(&fila, &item, 5) == TEMPO_ESGOTADO);
+	VERIFICA(ObtemMarcaDeTempo() - inicio == 5);
+	Envia(4);
+	Envia(5);
+	inicio = ObtemMarcaDeTempo();
+	item = 6;
+	VERIFICA(FilaEnvia(&fila, &item, 3) == TEMPO_ESGOTADO);
+	VERIFICA(ObtemMarcaDeTempo() - inicio == 3);
+	VERIFICA(fila.quantidade == CAPACIDADE && fila.fila_envio == 0);
+	VERIFICA(Recebe() == 4);
+	VERIFICA(Recebe() == 5);
+
+	/* a receptora que esgotou o tempo sai da fila de espera: o proximo item
+	   vai para a area */
+	inicio = ObtemMarcaDeTempo();
+	Comanda(1, RECEBE, 0xDEADu, 4);
+	TarefaEspera(6);
+	VERIFICA(concluidas[1] == 1 && resultado[1] == TEMPO_ESGOTADO);
+	VERIFICA(fim[1] - inicio == 4);
+	VERIFICA(valor[1] == 0xDEADu && fila.fila_recepcao == 0);
+	Envia(7);
+	VERIFICA(fila.quantidade == 1);
+	VERIFICA(Recebe() == 7);
+
+	/* modo ponteiro: o endereco passa pela area ou direto para a receptora,
+	   e a mensagem nao eh copiada (a alteracao depois do envio aparece) */
+	VERIFICA(FilaEnviaPonteiro(&fila_ponteiros, mensagens[0], 0) == SUCESSO);
+	mensagens[0][0] = 0x5A;
+	VERIFICA(FilaRecebePonteiro(&fila_ponteiros, &p, 0) == SUCESSO);
+	VERIFICA(p == mensagens[0] && ((uint8_t *)p)[0] == 0x5A);
+	Comanda(0, RECEBE_PONTEIRO, 0, ESPERA_INFINITA);
+	TarefaEspera(1);
+	VERIFICA(FilaEnviaPonteiro(&fila_ponteiros, mensagens[1], 0) == SUCESSO);
+	VERIFICA(fila_ponteiros.quantidade == 0);
+	TarefaEspera(1);
+	VERIFICA(resultado[0] == SUCESSO && ponteiro[0] == mensagens[1]);
+
+	/* receptoras esperando: os itens sao entregues em ordem de prioridade,
+	   nao na ordem em que comecaram a esperar */
+	Comanda(0, RECEBE, 0, ESPERA_INFINITA);
+	TarefaEspera(1);
+	Comanda(2, RECEBE, 0, ESPERA_INFINITA);
+	TarefaEspera(1);
+	Comanda(1, RECEBE, 0, ESPERA_INFINITA);
+	TarefaEspera(1);
+	Envia(10);
+	Envia(20);
+	Envia(30);
+	VERIFICA(valor[2] == 10 && valor[1] == 20 && valor[0] == 30);
+	TarefaEspera(1);
+	for(i = 0; i < TRABALHADORAS; i++)
+	{
+		VERIFICA(resultado[i] == SUCESSO);
+	}
+
+	/* remetentes esperando pela fila cheia: os itens entram em ordem de
+	   prioridade */
+	Envia(1);
+	Envia(2);
+	Comanda(1, ENVIA, 102, ESPERA_INFINITA);
+	TarefaEspera(1);
+	Comanda(0, ENVIA, 101, ESPERA_INFINITA);
+	TarefaEspera(1);
+	Comanda(2, ENVIA, 103, ESPERA_INFINITA);
+	TarefaEspera(1);
+	VERIFICA(Recebe() == 1);
+	VERIFICA(Recebe() == 2);
+	VERIFICA(Recebe() == 103);
+	VERIFICA(Recebe() == 102);
+	VERIFICA(Recebe() == 101);
+	VERIFICA(fila.quantidade == 0 && fila.fila_envio == 0);
+	TarefaEspera(1);
+	for(i = 0; i < TRABALHADORAS; i++)
+	{
+		VERIFICA(resultado[i] == SUCESSO);
+	}
+
+	printf("fila: entrega direta, remetente bloqueada, tempos limite exatos, "
+		"ponteiros sem copia e ordem de prioridade ok\n");
+	exit(0);
+}
+
+int main(void)
+{
+	uint32_t i;
+
+	CriaTarefa(controle, "controle", pilha_controle, TAM_PILHA, CONTROLE);
+	for(i = 0; i < TRABALHADORAS; i++)
+	{
+		CriaTarefa(trabalhadora, "trabalhadora", pilhas_trabalhadoras[i], TAM_PILHA, i + 1);
+	}
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
@@ -0,0 +1,172 @@
+/*
+ * teste_fila_spsc.c
+ *
+ * Fila SPSC entre uma interrupcao e uma tarefa, em tempo real. O produtor eh
+ * a interrupcao emulada (SIGUSR1 de um temporizador periodico rapido), que
+ * escreve lotes de tamanho ao acaso de uma sequencia de bytes; o consumidor
+ * eh uma tarefa que espera pelo sinal, esvazia a fila em leituras de
+ * tamanhos variados e confere cada byte com a sequencia. A capacidade eh
+ * pequena para que as escritas e leituras deem a volta na mascara; de tempos
+ * em tempos o consumidor dorme sem ler, e a fila enche. O produtor conta
+ * quantas vezes a quantidade cruzou o limiar: o semaforo deve ter sido
+ * liberado exatamente essas vezes.
+ */
+
+#define _GNU_SOURCE
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include "rtos.h"
+#include "fila_spsc.h"
+#include "teste.h"
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+
+#define CAPACIDADE		64
+#define LIMIAR			16
+#define MAIOR_LOTE		32			/* bytes por interrupcao, de 1 a MAIOR_LOTE */
+#define MAIOR_LEITURA	(CAPACIDADE + 5)
+#define TOTAL			200000		/* bytes conferidos */
+#define PERIODO_NS		20000		/* da interrupcao */
+#define SEQUENCIA		251			/* primo: a sequencia nao se alinha com a area */
+
+static uint32_t pilha_consumidora[TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static uint8_t area[CAPACIDADE];
+static semaforo_t sinal = {0, 0};
+static fila_spsc_t fila = FILA_SPSC_INICIALIZADOR(area, CAPACIDADE, &sinal, LIMIAR);
+
+static timer_t temporizador;
+
+/* contagens do produtor */
+static volatile uint32_t produzidos, cheia, voltas_escrita, sinais_esperados;
+
+/* contagens do consumidor */
+static uint32_t consumidos, vazia, voltas_leitura, acordadas, esgotadas;
+
+static void RotinaInterrupcao(void)
+{
+	uint8_t lote[MAIOR_LOTE];
+	uint32_t antes, posicao, n, escritos, i;
+
+	/* o consumidor nao executa durante a interrupcao: a quantidade eh exata */
+	antes = FilaSPSCQuantidade(&fila);
+	posicao = fila.escrita & fila.mascara;
+	n = 1 + Aleatorio(MAIOR_LOTE);
+	for(i = 0; i < n; i++)
+	{
+		lote[i] = (uint8_t)((produzidos + i) % SEQUENCIA);
+	}
+
+	escritos = FilaSPSCEscreve(&fila, lote, n);
+
+	/* escreve quantos couberem; os outros sao tentados de novo depois */
+	VERIFICA(escritos == (n < CAPACIDADE - antes ? n : CAPACIDADE - antes));
+	if(escritos < n)
+	{
+		cheia++;
+	}
+	if(posicao + escritos > CAPACIDADE)
+	{
+		voltas_escrita++;
+	}
+	if(antes < LIMIAR && antes + escritos >= LIMIAR)
+	{
+		sinais_esperados++;
+	}
+	produzidos += escritos;
+}
+
+/* le ate a fila ficar vazia, conferindo a sequencia */
+static void Esvazia(void)
+{
+	static uint32_t tamanho;
+	uint8_t dados[MAIOR_LEITURA];
+	uint32_t posicao, n, lidos, i;
+
+	do
+	{
+		posicao = fila.leitura & fila.mascara;
+		n = 1 + (tamanho++ % MAIOR_LEITURA);
+		lidos = FilaSPSCLe(&fila, dados, n);
+		VERIFICA(lidos <= n && lidos <= CAPACIDADE);
+		if(lidos == 0)
+		{
+			vazia++;
+		}
+		if(posicao + lidos > CAPACIDADE)
+		{
+			voltas_leitura++;
+		}
+		for(i = 0; i < lidos; i++)
+		{
+			if(dados[i] != (uint8_t)(consumidos % SEQUENCIA))
+			{
+				fprintf(stderr, "byte %u: %u, esperado %u\n", (unsigned)consumidos,
+					(unsigned)dados[i], (unsigned)(consumidos % SEQUENCIA));
+			}
+			VERIFICA(dados[i] == (uint8_t)(consumidos % SEQUENCIA));
+			consumidos++;
+		}
+	}while(lidos == n);
+}
+
+static void consumidora(void)
+{
+	while(consumidos < TOTAL)
+	{
+		/* o tempo limite recolhe lotes que ficaram abaixo do limiar */
+		if(SemaforoAguardaTempo(&sinal, 5) == SUCESSO)
+		{
+			acordadas++;
+			if(acordadas % 32 == 0)
+			{
+				TarefaEspera(2);		/* sem ler: a fila enche */
+			}
+		}else
+		{
+			esgotadas++;
+		}
+		Esvazia();
+	}
+
+	timer_delete(temporizador);
+
+	/* cada cruzamento do limiar liberou o semaforo uma vez */
+	VERIFICA(acordadas + sinal.contador == sinais_esperados);
+	VERIFICA(consumidos <= produzidos);
+
+	/* o teste so vale se todas as situacoes aconteceram muitas vezes */
+	VERIFICA(cheia > 100);
+	VERIFICA(vazia > 20);
+	VERIFICA(voltas_escrita > 100 && voltas_leitura > 100);
+	VERIFICA(acordadas > 100);
+
+	printf("fila spsc: %u bytes em ordem, %u acordadas pelo limiar (%u esgotadas), "
+		"cheia %u vezes, vazia %u vezes, %u/%u voltas na escrita/leitura\n",
+		(unsigned)consumidos, (unsigned)acordadas, (unsigned)esgotadas, (unsigned)cheia,
+		(unsigned)vazia, (unsigned)voltas_escrita, (unsigned)voltas_leitura);
+	exit(0);
+}
+
+int main(void)
+{
+	struct sigevent evento;
+	struct itimerspec valor = {{0, PERIODO_NS}, {0, PERIODO_NS}};
+
+	CriaTarefa(consumidora, "consumidora", pilha_consumidora, TAM_PILHA, 1);
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	PosixConfiguraInterrupcao(RotinaInterrupcao);
+	memset(&evento, 0, sizeof(evento));
+	evento.sigev_notify = SIGEV_SIGNAL;
+	evento.sigev_signo = SIGUSR1;
+	VERIFICA(timer_create(CLOCK_MONOTONIC, &evento, &temporizador) == 0);
+	VERIFICA(timer_settime(temporizador, 0, &valor, NULL) == 0);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
@@ -0,0 +1,157 @@
+/*
+ * teste_heranca.c
+ *
+ * Heranca de prioridade do mutex, com o tempo virtual. A tarefa baixa obtem o
+ * mutex, a alta passa a esperar por ele e a media, que so calcula, fica
+ * pronta logo depois: a baixa deve executar com a prioridade da alta e o
+ * bloqueio da alta fica limitado pela secao critica da baixa, e nao pelo
+ * calculo da media. No segundo cenario a heranca eh transitiva: a alta espera
+ * pelo mutex 2 da intermediaria, que espera pelo mutex 1 da baixa, e o
+ * bloqueio fica limitado pela soma das duas secoes criticas.
+ */
+
+#include "rtos.h"
+#include "teste.h"
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+
+#define BAIXA			1
+#define INTER			2
+#define MEDIA			3
+#define ALTA			4
+
+#define SECAO_BAIXA_A	5		/* secoes criticas, em marcas de tempo */
+#define SECAO_BAIXA_B	6
+#define SECAO_INTER		2
+#define CALCULO_MEDIA	50
+
+/* instantes do cenario A; o cenario B comeca em CENARIO_B */
+#define PEDIDO_ALTA		2
+#define INICIO_MEDIA	3
+#define CENARIO_B		100
+
+static uint32_t pilha_baixa[TAM_PILHA];
+static uint32_t pilha_inter[TAM_PILHA];
+static uint32_t pilha_media[TAM_PILHA];
+static uint32_t pilha_alta[TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static mutex_t mutex_1 = {0, 0, 0, NULL};
+static mutex_t mutex_2 = {0, 0, 0, NULL};
+
+static prioridade_t maxima_baixa_a, maxima_baixa_b, maxima_inter;
+
+/* trabalha marca a marca e guarda a maior prioridade com que executou */
+static void SecaoCritica(uint32_t marcas, prioridade_t *maxima)
+{
+	for(; marcas > 0; marcas--)
+	{
+		PosixAvancaMarcas(1);
+		if(TCB[tarefa_atual].prioridade > *maxima)
+		{
+			*maxima = TCB[tarefa_atual].prioridade;
+		}
+	}
+}
+
+static void baixa(void)
+{
+	tick_t ultimo = ObtemMarcaDeTempo();
+
+	MutexAguarda(&mutex_1);
+	SecaoCritica(SECAO_BAIXA_A, &maxima_baixa_a);
+	VERIFICA(MutexLibera(&mutex_1) == SUCESSO);
+	VERIFICA(TCB[tarefa_atual].prioridade == BAIXA);
+
+	TarefaEsperaAte(&ultimo, CENARIO_B);
+	MutexAguarda(&mutex_1);
+	SecaoCritica(SECAO_BAIXA_B, &maxima_baixa_b);
+	VERIFICA(MutexLibera(&mutex_1) == SUCESSO);
+	VERIFICA(TCB[tarefa_atual].prioridade == BAIXA);
+
+	for(;;)
+	{
+		TarefaEspera(1000);
+	}
+}
+
+static void inter(void)
+{
+	tick_t ultimo = ObtemMarcaDeTempo();
+
+	TarefaEsperaAte(&ultimo, CENARIO_B + 1);
+	MutexAguarda(&mutex_2);
+	MutexAguarda(&mutex_1);		/* a baixa herda a prioridade desta tarefa */
+	SecaoCritica(SECAO_INTER, &maxima_inter);
+	VERIFICA(MutexLibera(&mutex_1) == SUCESSO);
+	VERIFICA(MutexLibera(&mutex_2) == SUCESSO);
+	VERIFICA(TCB[tarefa_atual].prioridade == INTER);
+
+	for(;;)
+	{
+		TarefaEspera(1000);
+	}
+}
+
+/* so calcula: sem heranca, tomaria o processador da baixa */
+static void media(void)
+{
+	tick_t ultimo = ObtemMarcaDeTempo();
+
+	TarefaEsperaAte(&ultimo, INICIO_MEDIA);
+	PosixAvancaMarcas(CALCULO_MEDIA);
+	TarefaEsperaAte(&ultimo, CENARIO_B);
+	PosixAvancaMarcas(CALCULO_MEDIA);
+
+	for(;;)
+	{
+		TarefaEspera(1000);
+	}
+}
+
+static void alta(void)
+{
+	tick_t ultimo = ObtemMarcaDeTempo();
+	tick_t pedido, bloqueio_a, bloqueio_b;
+
+	/* cenario A: espera pelo mutex da baixa */
+	TarefaEsperaAte(&ultimo, PEDIDO_ALTA);
+	pedido = ObtemMarcaDeTempo();
+	MutexAguarda(&mutex_1);
+	bloqueio_a = ObtemMarcaDeTempo() - pedido;
+	VERIFICA(MutexLibera(&mutex_1) == SUCESSO);
+
+	VERIFICA(maxima_baixa_a == ALTA);
+	VERIFICA(bloqueio_a <= SECAO_BAIXA_A);
+
+	/* cenario B: espera pelo mutex da intermediaria, que espera pelo da baixa */
+	TarefaEsperaAte(&ultimo, CENARIO_B);
+	pedido = ObtemMarcaDeTempo();
+	MutexAguarda(&mutex_2);
+	bloqueio_b = ObtemMarcaDeTempo() - pedido;
+	VERIFICA(MutexLibera(&mutex_2) == SUCESSO);
+
+	VERIFICA(maxima_baixa_b == ALTA);
+	VERIFICA(maxima_inter == ALTA);
+	VERIFICA(bloqueio_b <= SECAO_BAIXA_B + SECAO_INTER);
+
+	printf("heranca: bloqueio da alta %u marcas (secao da baixa %u), "
+		"encadeada %u marcas (secoes %u + %u), media calcula %u marcas\n",
+		(unsigned)bloqueio_a, (unsigned)SECAO_BAIXA_A, (unsigned)bloqueio_b,
+		(unsigned)SECAO_BAIXA_B, (unsigned)SECAO_INTER, (unsigned)CALCULO_MEDIA);
+	exit(0);
+}
+
+int main(void)
+{
+	CriaTarefa(alta, "alta", pilha_alta, TAM_PILHA, ALTA);
+	CriaTarefa(media, "media", pilha_media, TAM_PILHA, MEDIA);
+	CriaTarefa(inter, "inter", pilha_inter, TAM_PILHA, INTER);
+	CriaTarefa(baixa, "baixa", pilha_baixa, TAM_PILHA, BAIXA);
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
@@ -0,0 +1,134 @@
+/*
+ * teste_perfil.c
+ *
+ * Perfil estatistico (cfg_PERFIL), em tempo real: a rotina da marca de tempo
+ * guarda o PC interrompido. A tarefa pesada calcula sem parar em
+ * CalculaPesado e a leve calcula LEVE marcas de cada PERIODO em CalculaLeve.
+ * Depois de AMOSTRAS marcas a de controle verifica o buffer (uma amostra por
+ * marca, a divisao entre as tarefas e os nomes) e o grava em ARQUIVO_PERFIL,
+ * que o make test converte com tools/perfil.py e o nm do proprio teste: a
+ * funcao mais amostrada deve ser CalculaPesado e a seguinte CalculaLeve.
+ */
+
+#include <string.h>
+#include "rtos.h"
+#include "teste.h"
+
+#if cfg_PERFIL != 1024
+#error "o teste precisa de cfg_PERFIL = 1024"
+#endif
+
+#ifndef ARQUIVO_PERFIL
+#define ARQUIVO_PERFIL	"obj/perfil.bin"
+#endif
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+
+#define ID_CONTROLE		1
+#define ID_LEVE			2
+#define ID_PESADA		3
+
+#define AMOSTRAS		500			/* marcas de tempo, menos que cfg_PERFIL */
+#define PERIODO			10
+#define LEVE			2
+
+static uint32_t pilha_controle[TAM_PILHA];
+static uint32_t pilha_leve[TAM_PILHA];
+static uint32_t pilha_pesada[TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static volatile uint32_t contas;
+
+/* calcula ate a marca de tempo fim. Um sinal que chega com as interrupcoes
+   desabilitadas eh atendido quando elas voltam, e a amostra cai na biblioteca
+   C (sigprocmask): o relogio so eh lido a cada 65536 contas */
+static __attribute__((noinline)) void CalculaLeve(tick_t fim)
+{
+	while((int32_t)(ObtemMarcaDeTempo() - fim) < 0)
+	{
+		uint32_t i;
+
+		for(i = 0; i < 65536; i++)
+		{
+			contas++;
+		}
+	}
+}
+
+static __attribute__((noinline)) void CalculaPesado(void)
+{
+	for(;;)
+	{
+		contas++;
+	}
+}
+
+static void leve(void)
+{
+	tick_t ultimo = ObtemMarcaDeTempo();
+
+	for(;;)
+	{
+		CalculaLeve(ultimo + LEVE);
+		TarefaEsperaAte(&ultimo, PERIODO);
+	}
+}
+
+static void pesada(void)
+{
+	CalculaPesado();
+}
+
+static void controle(void)
+{
+	uint32_t por_tarefa[NUMERO_DE_TAREFAS + 1];
+	uint32_t i, indice;
+	FILE *arquivo;
+
+	TarefaEspera(AMOSTRAS);
+	REG_ATOMICA_INICIO();
+	indice = perfil.indice;
+	REG_ATOMICA_FIM();
+
+	/* uma amostra por sinal da marca de tempo; um sinal atrasado conta mais de
+	   uma marca com uma so amostra */
+	VERIFICA(perfil.identificador == PERFIL_IDENTIFICADOR);
+	VERIFICA(perfil.numero_amostras == cfg_PERFIL && perfil.frequencia == cfg_MARCA_TEMPO_HZ);
+	VERIFICA(indice > AMOSTRAS / 2 && indice <= AMOSTRAS + 1);
+	VERIFICA(strncmp(perfil.nomes[ID_PESADA], "pesada", PERFIL_TAM_NOME) == 0);
+
+	/* a leve executa LEVE marcas de cada PERIODO e a pesada o resto; a folga
+	   cobre a carga do computador */
+	memset(por_tarefa, 0, sizeof(por_tarefa));
+	for(i = 0; i < indice; i++)
+	{
+		VERIFICA(perfil.tarefa[i] >= 1 && perfil.tarefa[i] <= NUMERO_DE_TAREFAS);
+		VERIFICA(perfil.pc[i] != 0);
+		por_tarefa[perfil.tarefa[i]]++;
+	}
+	VERIFICA(por_tarefa[ID_PESADA] * 100 >= indice * 50);
+	VERIFICA(por_tarefa[ID_LEVE] * 100 >= indice * 5 && por_tarefa[ID_LEVE] * 100 <= indice * 40);
+
+	arquivo = fopen(ARQUIVO_PERFIL, "wb");
+	VERIFICA(arquivo != NULL);
+	VERIFICA(fwrite(&perfil, sizeof(perfil), 1, arquivo) == 1);
+	fclose(arquivo);
+
+	printf("perfil: %u amostras em %u marcas, %u%% na pesada, %u%% na leve\n",
+		(unsigned)indice, (unsigned)ObtemMarcaDeTempo(), (unsigned)(por_tarefa[ID_PESADA] * 100 / indice),
+		(unsigned)(por_tarefa[ID_LEVE] * 100 / indice));
+	exit(0);
+}
+
+int main(void)
+{
+	CriaTarefa(controle, "controle", pilha_controle, TAM_PILHA, 3);
+	CriaTarefa(leve, "leve", pilha_leve, TAM_PILHA, 2);
+	CriaTarefa(pesada, "pesada", pilha_pesada, TAM_PILHA, 1);
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
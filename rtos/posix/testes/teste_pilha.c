@@ -0,0 +1,134 @@
+/*
+ * teste_pilha.c
+ *
+ * Verificacao das pilhas (cfg_VERIFICA_PILHA), com o tempo virtual. A tarefa
+ * medidora usa uma quantidade conhecida de pilha, preenchida com um valor
+ * diferente do padrao, e a marca d'agua (TarefaPilhaLivre) deve baixar isso,
+ * com pouca folga, e nao voltar depois. A tarefa que estoura
+ * altera a sua palavra de guarda: na proxima troca de contexto o nucleo deve
+ * chamar EstouroDePilha com o identificador dela, redefinida aqui para
+ * registrar a chamada e restaurar a palavra.
+ */
+
+#include <alloca.h>
+#include "rtos.h"
+#include "teste.h"
+
+#if !cfg_VERIFICA_PILHA
+#error "o teste precisa de cfg_VERIFICA_PILHA = 1"
+#endif
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+
+#define USO				2048		/* palavras usadas pela medidora */
+#define FOLGA			256			/* em palavras, para mais ou para menos */
+
+#define ID_MEDIDORA		2
+#define ID_QUIETA		3
+#define ID_ESTOURA		4
+
+static uint32_t pilha_controle[TAM_PILHA];
+static uint32_t pilha_medidora[TAM_PILHA];
+static uint32_t pilha_quieta[TAM_PILHA];
+static uint32_t pilha_estoura[TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static volatile uint32_t estouros;
+static volatile id_tarefa_t id_estouro;
+
+static uint16_t livre_antes, livre_depois, livre_final;
+
+/* chamada na troca de contexto, com as interrupcoes desabilitadas */
+void EstouroDePilha(id_tarefa_t id_tarefa)
+{
+	estouros++;
+	id_estouro = id_tarefa;
+	*TCB[id_tarefa].pilha_inicio = PADRAO_PILHA;
+}
+
+/* ocupa palavras palavras da pilha (alloca: na pilha da tarefa mesmo com o
+   AddressSanitizer) */
+static __attribute__((noinline)) void UsaPilha(uint32_t palavras)
+{
+	volatile uint32_t *area = alloca(palavras * sizeof(uint32_t));
+	uint32_t i;
+
+	for(i = 0; i < palavras; i++)
+	{
+		area[i] = i;
+	}
+}
+
+static void medidora(void)
+{
+	TarefaEspera(1);		/* a pilha ja passou por uma troca de contexto */
+	livre_antes = TarefaPilhaLivre(ID_MEDIDORA);
+	UsaPilha(USO);
+	livre_depois = TarefaPilhaLivre(ID_MEDIDORA);
+	TarefaEspera(1);
+	livre_final = TarefaPilhaLivre(ID_MEDIDORA);
+	for(;;)
+	{
+		TarefaEspera(1000);
+	}
+}
+
+static void quieta(void)
+{
+	for(;;)
+	{
+		TarefaEspera(1);
+	}
+}
+
+static void estoura(void)
+{
+	TarefaEspera(5);
+	*TCB[tarefa_atual].pilha_inicio = 0;		/* a palavra de guarda */
+	TarefaEspera(1000);
+}
+
+static void controle(void)
+{
+	/* muitas trocas de contexto sem estouro */
+	TarefaEspera(4);
+	VERIFICA(estouros == 0);
+
+	/* a marca d'agua baixou pelo uso conhecido e nao volta; a folga cobre os
+	   quadros de UsaPilha e o que as chamadas anteriores ja tinham usado
+	   abaixo do ponto do alloca */
+	VERIFICA(livre_antes >= livre_depois + USO - FOLGA);
+	VERIFICA(livre_antes <= livre_depois + USO + FOLGA);
+	VERIFICA(livre_final == livre_depois);
+	VERIFICA(TarefaPilhaLivre(ID_QUIETA) > livre_depois + USO - FOLGA);
+	VERIFICA(TarefaPilhaLivre(ID_QUIETA) < TAM_PILHA);
+
+	/* a estoura altera a palavra de guarda e dorme: a troca de contexto
+	   detecta e identifica a tarefa */
+	TarefaEspera(2);
+	VERIFICA(estouros == 1 && id_estouro == ID_ESTOURA);
+	VERIFICA(*TCB[ID_ESTOURA].pilha_inicio == PADRAO_PILHA);
+
+	/* restaurada a palavra, nao ha mais chamadas */
+	TarefaEspera(10);
+	VERIFICA(estouros == 1);
+
+	printf("pilha: %u palavras usadas baixaram a marca d'agua em %u, estouro "
+		"da tarefa %u detectado na troca de contexto\n", (unsigned)USO,
+		(unsigned)(livre_antes - livre_depois), (unsigned)id_estouro);
+	exit(0);
+}
+
+int main(void)
+{
+	CriaTarefa(controle, "controle", pilha_controle, TAM_PILHA, 4);
+	CriaTarefa(medidora, "medidora", pilha_medidora, TAM_PILHA, 3);
+	CriaTarefa(quieta, "quieta", pilha_quieta, TAM_PILHA, 2);
+	CriaTarefa(estoura, "estoura", pilha_estoura, TAM_PILHA, 1);
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
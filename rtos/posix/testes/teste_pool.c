@@ -0,0 +1,165 @@
+/*
+ * teste_pool.c
+ *
+ * Conjunto (pool) de blocos de memoria, com o tempo virtual. A tarefa de
+ * controle, de maior prioridade, esgota o conjunto e verifica:
+ *  - a alocacao sem espera falha na hora e conta em falhas;
+ *  - a espera com tempo limite termina na marca pedida e tambem conta;
+ *  - o bloco liberado vai direto para a tarefa esperando de maior
+ *    prioridade (por dados_espera), sem voltar a lista de livres;
+ *  - em_uso e maximo_em_uso acompanham as alocacoes, e os blocos liberados
+ *    voltam a ser alocados.
+ */
+
+#include <string.h>
+#include "rtos.h"
+#include "teste.h"
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+
+#define TRABALHADORAS	3			/* trabalhadora i tem prioridade i + 1 */
+#define CONTROLE		4
+
+#define TAM_BLOCO		20			/* arredondado para multiplo de ponteiro */
+#define BLOCOS			3
+
+typedef enum {ALOCA, LIBERA} comando_t;
+
+static uint32_t pilha_controle[TAM_PILHA];
+static uint32_t pilhas_trabalhadoras[TRABALHADORAS][TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static POOL_MEMORIA_AREA(area, TAM_BLOCO, BLOCOS);
+static pool_memoria_t pool;
+
+/* comando e resultado de cada trabalhadora */
+static semaforo_t partida[TRABALHADORAS];
+static comando_t comando[TRABALHADORAS];
+static tick_t tempo[TRABALHADORAS];
+static void *bloco[TRABALHADORAS];
+static tick_t fim[TRABALHADORAS];
+static uint32_t concluidas[TRABALHADORAS];
+
+static void trabalhadora(void)
+{
+	uint32_t i = TCB[tarefa_atual].prioridade - 1;
+
+	for(;;)
+	{
+		SemaforoAguarda(&partida[i]);
+		if(comando[i] == ALOCA)
+		{
+			bloco[i] = PoolAloca(&pool, tempo[i]);
+		}else
+		{
+			PoolLibera(&pool, bloco[i]);
+			bloco[i] = NULL;
+		}
+		fim[i] = ObtemMarcaDeTempo();
+		concluidas[i]++;
+	}
+}
+
+/* a trabalhadora i executa o comando quando a de controle dormir, ainda na
+   mesma marca de tempo */
+static void Comanda(uint32_t i, comando_t c, tick_t t)
+{
+	comando[i] = c;
+	tempo[i] = t;
+	SemaforoLibera(&partida[i]);
+}
+
+static void controle(void)
+{
+	void *b[BLOCOS];
+	uint8_t *inicio_area = (uint8_t *)area, *fim_area = (uint8_t *)area + sizeof(area);
+	uint32_t i, j;
+	tick_t inicio;
+
+	PoolCria(&pool, area, TAM_BLOCO, BLOCOS);
+	VERIFICA(pool.tamanho_bloco == (TAM_BLOCO + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *));
+
+	/* blocos distintos, alinhados e dentro da area */
+	for(i = 0; i < BLOCOS; i++)
+	{
+		b[i] = PoolAloca(&pool, 0);
+		VERIFICA(b[i] != NULL);
+		VERIFICA((uint8_t *)b[i] >= inicio_area && (uint8_t *)b[i] + pool.tamanho_bloco <= fim_area);
+		VERIFICA((uintptr_t)b[i] % sizeof(void *) == 0);
+		for(j = 0; j < i; j++)
+		{
+			VERIFICA(b[i] != b[j]);
+		}
+		memset(b[i], 0xA5, TAM_BLOCO);		/* nao alcanca os outros blocos */
+	}
+	VERIFICA(pool.em_uso == BLOCOS && pool.maximo_em_uso == BLOCOS && pool.livres == NULL);
+
+	/* esgotado: sem espera falha na hora */
+	VERIFICA(pool.falhas == 0);
+	VERIFICA(PoolAloca(&pool, 0) == NULL);
+	VERIFICA(pool.falhas == 1);
+
+	/* tempo limite exato, da de controle e de uma trabalhadora */
+	inicio = ObtemMarcaDeTempo();
+	VERIFICA(PoolAloca(&pool, 4) == NULL);
+	VERIFICA(ObtemMarcaDeTempo() - inicio == 4 && pool.falhas == 2);
+	inicio = ObtemMarcaDeTempo();
+	Comanda(1, ALOCA, 3);
+	TarefaEspera(5);
+	VERIFICA(concluidas[1] == 1 && bloco[1] == NULL && fim[1] - inicio == 3);
+	VERIFICA(pool.falhas == 3 && pool.fila_espera == 0);
+
+	/* entrega direta: duas trabalhadoras esperam; cada bloco liberado vai
+	   para a de maior prioridade, mesmo que tenha comecado a esperar depois */
+	Comanda(0, ALOCA, ESPERA_INFINITA);
+	TarefaEspera(1);
+	Comanda(2, ALOCA, ESPERA_INFINITA);
+	TarefaEspera(1);
+	VERIFICA(concluidas[0] == 0 && concluidas[2] == 0);
+	PoolLibera(&pool, b[1]);
+	VERIFICA(pool.livres == NULL && pool.em_uso == BLOCOS);
+	TarefaEspera(1);
+	VERIFICA(concluidas[2] == 1 && bloco[2] == b[1] && concluidas[0] == 0);
+	PoolLibera(&pool, b[0]);
+	VERIFICA(pool.livres == NULL && pool.em_uso == BLOCOS && pool.fila_espera == 0);
+	TarefaEspera(1);
+	VERIFICA(concluidas[0] == 1 && bloco[0] == b[0]);
+	VERIFICA(pool.falhas == 3 && pool.maximo_em_uso == BLOCOS);
+
+	/* todos liberados: voltam a lista de livres e podem ser alocados de novo */
+	Comanda(0, LIBERA, 0);
+	Comanda(2, LIBERA, 0);
+	TarefaEspera(1);
+	PoolLibera(&pool, b[2]);
+	VERIFICA(pool.em_uso == 0 && pool.livres != NULL && pool.fila_espera == 0);
+	VERIFICA(PoolAloca(&pool, 0) == b[2]);		/* o ultimo liberado */
+	for(i = 1; i < BLOCOS; i++)
+	{
+		void *outro = PoolAloca(&pool, 0);
+		VERIFICA(outro == b[0] || outro == b[1]);
+	}
+	VERIFICA(PoolAloca(&pool, 0) == NULL && pool.falhas == 4);
+	VERIFICA(pool.em_uso == BLOCOS && pool.maximo_em_uso == BLOCOS);
+
+	printf("pool: %u blocos de %u bytes, esgotado, tempo limite exato, entrega "
+		"direta por prioridade, %u falhas contadas\n", (unsigned)BLOCOS,
+		(unsigned)pool.tamanho_bloco, (unsigned)pool.falhas);
+	exit(0);
+}
+
+int main(void)
+{
+	uint32_t i;
+
+	CriaTarefa(controle, "controle", pilha_controle, TAM_PILHA, CONTROLE);
+	for(i = 0; i < TRABALHADORAS; i++)
+	{
+		CriaTarefa(trabalhadora, "trabalhadora", pilhas_trabalhadoras[i], TAM_PILHA, i + 1);
+	}
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
@@ -0,0 +1,94 @@
+/*
+ * teste_porta.c
+ *
+ * Testa a propria porta para Linux, com o tempo virtual: a pilha de cada
+ * tarefa tem o tamanho passado a CriaTarefa, a interrupcao emulada (SIGUSR1)
+ * troca de contexto so no fim da rotina e o tempo virtual so avanca com
+ * PosixAvancaMarcas e com a tarefa ociosa.
+ */
+
+#include <signal.h>
+#include "rtos.h"
+#include "teste.h"
+
+#define TAM_PILHA			(TAM_MINIMO_PILHA + 24)
+#define TAM_PILHA_GRANDE	(3 * TAM_MINIMO_PILHA)
+
+static uint32_t pilha_alta[TAM_PILHA];
+static uint32_t pilha_baixa[TAM_PILHA_GRANDE];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static semaforo_t semaforo = {0, 0};
+static volatile uint8_t alta_acordou = 0;
+static volatile uint8_t alta_na_rotina = 0;
+
+/* usa quase toda a pilha grande: so cabe se o contexto recebeu o seu tamanho */
+static uint32_t Recursiva(uint32_t nivel)
+{
+	volatile uint32_t area[256];
+
+	area[nivel % 256] = nivel;
+	if(nivel == 0)
+	{
+		return area[0];
+	}
+	return Recursiva(nivel - 1) + area[nivel % 256];
+}
+
+static void RotinaInterrupcao(void)
+{
+	SemaforoLibera(&semaforo);
+	alta_na_rotina = alta_acordou;		/* a tarefa acordada ainda nao executou */
+}
+
+static void tarefa_alta(void)
+{
+	SemaforoAguarda(&semaforo);
+	alta_acordou = 1;
+	SemaforoAguarda(&semaforo);
+}
+
+static void tarefa_baixa(void)
+{
+	tick_t inicio = ObtemMarcaDeTempo();
+
+	/* 2 * TAM_MINIMO_PILHA palavras, em niveis de 256: mais que a pilha minima */
+	VERIFICA(Recursiva((2 * TAM_MINIMO_PILHA) / 256) != 0);
+
+	/* a interrupcao acorda a tarefa alta, que executa na saida da rotina */
+	raise(SIGUSR1);
+	VERIFICA(alta_na_rotina == 0);
+	VERIFICA(alta_acordou == 1);
+
+	/* o tempo virtual so avanca quando a tarefa diz que trabalhou... */
+	VERIFICA(ObtemMarcaDeTempo() == inicio);
+	PosixAvancaMarcas(5);
+	VERIFICA(ObtemMarcaDeTempo() == inicio + 5);
+
+	/* ... ou quando a tarefa ociosa dorme ate o proximo despertar */
+	TarefaEspera(1000);
+	VERIFICA(ObtemMarcaDeTempo() == inicio + 1005);
+
+	printf("porta: pilhas, interrupcao e tempo virtual ok\n");
+	exit(0);
+}
+
+int main(void)
+{
+	contexto_posix_t *contexto;
+
+	CriaTarefa(tarefa_alta, "alta", pilha_alta, TAM_PILHA, 3);
+	CriaTarefa(tarefa_baixa, "baixa", pilha_baixa, TAM_PILHA_GRANDE, 1);
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	/* a tarefa usa a pilha inteira, e nao so TAM_MINIMO_PILHA palavras */
+	contexto = (contexto_posix_t *)((uintptr_t)TCB[2].stack_pointer & ~(uintptr_t)15);
+	VERIFICA(contexto->contexto.uc_stack.ss_sp == (void *)pilha_baixa);
+	VERIFICA(contexto->contexto.uc_stack.ss_size > (TAM_PILHA_GRANDE - TAM_CONTEXTO - 4) * sizeof(uint32_t));
+
+	PosixConfiguraInterrupcao(RotinaInterrupcao);
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
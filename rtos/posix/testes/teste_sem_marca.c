@@ -0,0 +1,152 @@
+/*
+ * teste_sem_marca.c
+ *
+ * Deriva do modo sem marca de tempo, em tempo real: tarefas dormem tempos ao
+ * acaso e uma interrupcao emulada (SIGUSR1 de um temporizador reprogramado
+ * ao acaso) acorda o processador antes do fim do sono da tarefa ociosa. A
+ * cada despertar, a tarefa verificadora compara o contador de marcas de tempo
+ * com as marcas que o relogio do computador diz que passaram desde o inicio:
+ * a diferenca nunca passa de uma marca. As outras tarefas tambem verificam,
+ * inclusive a acordada pela interrupcao no meio do sono.
+ */
+
+#define _GNU_SOURCE
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include "rtos.h"
+#include "teste.h"
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+#define DURACAO			2000			/* marcas de tempo */
+#define PERIODO_NS		(1000000000u / cfg_MARCA_TEMPO_HZ)
+
+static uint32_t pilha_verificadora[TAM_PILHA];
+static uint32_t pilha_acordada[TAM_PILHA];
+static uint32_t pilhas_dorminhocas[2][TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+#define ID_OCIOSA		5
+
+static semaforo_t semaforo = {0, 0};
+static timer_t temporizador;
+static uint64_t inicio_ns;
+
+static volatile uint32_t interrupcoes, interrupcoes_na_ociosa;
+static uint32_t sonos, despertares_antecipados, verificacoes;
+
+static uint64_t Agora(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+}
+
+/* marcas de tempo inteiras que o relogio diz que passaram */
+static int64_t MarcasReais(void)
+{
+	return (int64_t)((Agora() - inicio_ns) / PERIODO_NS);
+}
+
+/* proxima interrupcao entre 0,2 e 8 ms, fora das fronteiras das marcas */
+static void ProgramaInterrupcao(void)
+{
+	struct itimerspec valor = {{0, 0}, {0, 0}};
+
+	valor.it_value.tv_nsec = 200000 + (long)Aleatorio(7800000);
+	timer_settime(temporizador, 0, &valor, NULL);
+}
+
+static void RotinaInterrupcao(void)
+{
+	interrupcoes++;
+	if(tarefa_atual == ID_OCIOSA)
+	{
+		interrupcoes_na_ociosa++;		/* acordou a ociosa no meio do sono */
+	}
+	SemaforoLibera(&semaforo);
+	ProgramaInterrupcao();
+}
+
+/* o contador fica entre as marcas reais lidas antes e depois dele */
+static void Verifica(void)
+{
+	int64_t antes, depois, contador;
+
+	antes = MarcasReais();
+	contador = (int64_t)ObtemMarcaDeTempo();
+	depois = MarcasReais();
+	if(contador < antes - 1 || contador > depois + 1)
+	{
+		fprintf(stderr, "marca %lld, relogio %lld..%lld\n",
+			(long long)contador, (long long)antes, (long long)depois);
+	}
+	VERIFICA(contador >= antes - 1 && contador <= depois + 1);
+	verificacoes++;
+}
+
+static void verificadora(void)
+{
+	while(ObtemMarcaDeTempo() < DURACAO)
+	{
+		TarefaEspera(1 + Aleatorio(7));
+		Verifica();
+	}
+
+	/* o teste so vale se a ociosa dormiu e foi acordada antes muitas vezes */
+	VERIFICA(interrupcoes_na_ociosa > 50);
+	VERIFICA(despertares_antecipados > 50);
+
+	printf("sem marca: %u verificacoes em %u marcas, %u sonos, %u interrupcoes "
+		"(%u na ociosa), %u despertares antecipados, diferenca <= 1 marca\n",
+		(unsigned)verificacoes, (unsigned)DURACAO, (unsigned)sonos, (unsigned)interrupcoes,
+		(unsigned)interrupcoes_na_ociosa, (unsigned)despertares_antecipados);
+	exit(0);
+}
+
+/* acordada pela interrupcao antes do tempo limite, ou pelo tempo limite */
+static void acordada(void)
+{
+	for(;;)
+	{
+		if(SemaforoAguardaTempo(&semaforo, 5 + Aleatorio(50)) == SUCESSO)
+		{
+			despertares_antecipados++;
+		}
+		Verifica();		/* logo depois de a interrupcao acordar a ociosa */
+	}
+}
+
+static void dorminhoca(void)
+{
+	for(;;)
+	{
+		TarefaEspera(1 + Aleatorio(40));
+		sonos++;
+		Verifica();
+	}
+}
+
+int main(void)
+{
+	struct sigevent evento;
+
+	CriaTarefa(verificadora, "verificadora", pilha_verificadora, TAM_PILHA, 4);
+	CriaTarefa(acordada, "acordada", pilha_acordada, TAM_PILHA, 3);
+	CriaTarefa(dorminhoca, "dorminhoca 1", pilhas_dorminhocas[0], TAM_PILHA, 2);
+	CriaTarefa(dorminhoca, "dorminhoca 2", pilhas_dorminhocas[1], TAM_PILHA, 2);
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	PosixConfiguraInterrupcao(RotinaInterrupcao);
+	memset(&evento, 0, sizeof(evento));
+	evento.sigev_notify = SIGEV_SIGNAL;
+	evento.sigev_signo = SIGUSR1;
+	VERIFICA(timer_create(CLOCK_MONOTONIC, &evento, &temporizador) == 0);
+	ProgramaInterrupcao();
+
+	inicio_ns = Agora();
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
@@ -0,0 +1,133 @@
+/*
+ * teste_semaforo.c
+ *
+ * Fila de espera do semaforo em ordem de prioridade, com o tempo virtual. As
+ * trabalhadoras comecam a esperar da menor para a maior prioridade e a de
+ * controle verifica:
+ *  - a fila fica em ordem de prioridade e cada liberacao acorda a primeira;
+ *  - sem ninguem esperando, a liberacao incrementa o contador, que a proxima
+ *    espera consome sem bloquear;
+ *  - TarefaContinua retira a tarefa da fila do semaforo antes de coloca-la
+ *    na fila de prontas, e a liberacao seguinte vai para a que restou.
+ */
+
+#include "rtos.h"
+#include "teste.h"
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+
+#define TRABALHADORAS	3			/* trabalhadora i tem prioridade i + 1 */
+#define CONTROLE		4
+
+static uint32_t pilha_controle[TAM_PILHA];
+static uint32_t pilhas_trabalhadoras[TRABALHADORAS][TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static semaforo_t semaforo = {0, 0};
+
+static semaforo_t partida[TRABALHADORAS];
+static id_tarefa_t id[TRABALHADORAS];
+static uint32_t concluidas[TRABALHADORAS];
+
+/* ordem em que as trabalhadoras obtiveram o semaforo */
+static uint32_t ordem[2 * TRABALHADORAS];
+static uint32_t obtidos;
+
+static void trabalhadora(void)
+{
+	uint32_t i = TCB[tarefa_atual].prioridade - 1;
+
+	id[i] = tarefa_atual;
+	for(;;)
+	{
+		SemaforoAguarda(&partida[i]);
+		SemaforoAguarda(&semaforo);
+		ordem[obtidos++] = i;
+		concluidas[i]++;
+	}
+}
+
+/* a trabalhadora i comeca a esperar quando a de controle dormir */
+static void Aguarda(uint32_t i)
+{
+	SemaforoLibera(&partida[i]);
+	TarefaEspera(1);
+}
+
+static void controle(void)
+{
+	id_tarefa_t tarefa;
+	uint32_t i;
+
+	/* da menor para a maior prioridade: a fila fica na ordem inversa */
+	for(i = 0; i < TRABALHADORAS; i++)
+	{
+		Aguarda(i);
+	}
+	VERIFICA(obtidos == 0 && semaforo.contador == 0);
+	tarefa = semaforo.fila_espera;
+	for(i = TRABALHADORAS; i > 0; i--)
+	{
+		VERIFICA(tarefa == id[i - 1]);
+		VERIFICA(TCB[tarefa].fila_espera == &semaforo.fila_espera);
+		tarefa = TCB[tarefa].proxima;
+	}
+	VERIFICA(tarefa == semaforo.fila_espera);		/* lista circular */
+
+	/* cada liberacao acorda a primeira da fila, sem passar pelo contador */
+	for(i = 0; i < TRABALHADORAS; i++)
+	{
+		SemaforoLibera(&semaforo);
+		VERIFICA(semaforo.contador == 0);
+		TarefaEspera(1);
+		VERIFICA(obtidos == i + 1 && ordem[i] == TRABALHADORAS - 1 - i);
+	}
+	VERIFICA(semaforo.fila_espera == 0);
+	for(i = 0; i < TRABALHADORAS; i++)
+	{
+		VERIFICA(TCB[id[i]].fila_espera == &partida[i].fila_espera);	/* de volta a partida */
+	}
+
+	/* ninguem esperando: o contador guarda as liberacoes */
+	SemaforoLibera(&semaforo);
+	SemaforoLibera(&semaforo);
+	VERIFICA(semaforo.contador == 2);
+	SemaforoAguarda(&semaforo);
+	VERIFICA(semaforo.contador == 1);
+	Aguarda(1);
+	VERIFICA(concluidas[1] == 2 && semaforo.contador == 0 && semaforo.fila_espera == 0);
+
+	/* TarefaContinua tira a tarefa da fila antes de torna-la pronta: a
+	   liberacao seguinte vai para a outra */
+	Aguarda(0);
+	Aguarda(2);
+	VERIFICA(semaforo.fila_espera == id[2] && TCB[id[2]].proxima == id[0]);
+	VERIFICA(TarefaContinua(id[2]) == SUCESSO);
+	TarefaEspera(1);
+	VERIFICA(concluidas[2] == 2 && TCB[id[2]].fila_espera == &partida[2].fila_espera);
+	VERIFICA(semaforo.fila_espera == id[0] && TCB[id[0]].proxima == id[0]);
+	SemaforoLibera(&semaforo);
+	TarefaEspera(1);
+	VERIFICA(concluidas[0] == 2 && semaforo.fila_espera == 0 && semaforo.contador == 0);
+
+	printf("semaforo: fila em ordem de prioridade, %u liberacoes em ordem, contador "
+		"sem espera e TarefaContinua retirando da fila ok\n", (unsigned)TRABALHADORAS);
+	exit(0);
+}
+
+int main(void)
+{
+	uint32_t i;
+
+	CriaTarefa(controle, "controle", pilha_controle, TAM_PILHA, CONTROLE);
+	for(i = 0; i < TRABALHADORAS; i++)
+	{
+		CriaTarefa(trabalhadora, "trabalhadora", pilhas_trabalhadoras[i], TAM_PILHA, i + 1);
+	}
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
@@ -0,0 +1,130 @@
+/*
+ * teste_semaforo_tempo.c
+ *
+ * SemaforoAguardaTempo, com o tempo virtual. A tarefa de controle, de maior
+ * prioridade, poe as trabalhadoras para esperar com tempos limite e verifica:
+ *  - com tempo 0 so testa o semaforo, sem bloquear;
+ *  - o tempo limite termina a espera exatamente na marca pedida e tira a
+ *    tarefa da fila do semaforo, enquanto a outra continua esperando;
+ *  - a liberacao antes do tempo limite retorna SUCESSO e tira a tarefa da
+ *    lista temporizada, sem um despertar atrasado depois;
+ *  - TarefaContinua termina a espera com ESPERA_INTERROMPIDA, com ou sem
+ *    tempo limite.
+ */
+
+#include "rtos.h"
+#include "teste.h"
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+
+#define TRABALHADORAS	2			/* trabalhadora i tem prioridade i + 1 */
+#define CONTROLE		3
+
+static uint32_t pilha_controle[TAM_PILHA];
+static uint32_t pilhas_trabalhadoras[TRABALHADORAS][TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static semaforo_t semaforo = {0, 0};
+
+/* comando e resultado de cada trabalhadora */
+static semaforo_t partida[TRABALHADORAS];
+static id_tarefa_t id[TRABALHADORAS];
+static tick_t tempo[TRABALHADORAS];
+static resultado_t resultado[TRABALHADORAS];
+static tick_t fim[TRABALHADORAS];
+static uint32_t concluidas[TRABALHADORAS];
+
+static void trabalhadora(void)
+{
+	uint32_t i = TCB[tarefa_atual].prioridade - 1;
+
+	id[i] = tarefa_atual;
+	for(;;)
+	{
+		SemaforoAguarda(&partida[i]);
+		resultado[i] = SemaforoAguardaTempo(&semaforo, tempo[i]);
+		fim[i] = ObtemMarcaDeTempo();
+		concluidas[i]++;
+	}
+}
+
+/* a trabalhadora i comeca a esperar quando a de controle dormir, ainda na
+   mesma marca de tempo */
+static void Aguarda(uint32_t i, tick_t t)
+{
+	tempo[i] = t;
+	SemaforoLibera(&partida[i]);
+}
+
+static void controle(void)
+{
+	tick_t inicio;
+
+	/* tempo 0: so testa */
+	VERIFICA(SemaforoAguardaTempo(&semaforo, 0) == TEMPO_ESGOTADO);
+	SemaforoLibera(&semaforo);
+	VERIFICA(SemaforoAguardaTempo(&semaforo, 0) == SUCESSO && semaforo.contador == 0);
+	Aguarda(0, 0);
+	TarefaEspera(1);
+	VERIFICA(concluidas[0] == 1 && resultado[0] == TEMPO_ESGOTADO);
+
+	/* tempos limite diferentes: a de tempo menor sai da fila na marca exata
+	   e a outra continua esperando ate a liberacao */
+	inicio = ObtemMarcaDeTempo();
+	Aguarda(0, 4);
+	Aguarda(1, 20);
+	TarefaEspera(6);
+	VERIFICA(concluidas[0] == 2 && resultado[0] == TEMPO_ESGOTADO && fim[0] - inicio == 4);
+	VERIFICA(concluidas[1] == 0 && semaforo.fila_espera == id[1]);
+	VERIFICA(TCB[id[1]].proxima == id[1]);
+	SemaforoLibera(&semaforo);
+	TarefaEspera(1);
+	VERIFICA(concluidas[1] == 1 && resultado[1] == SUCESSO && fim[1] - inicio == 6);
+	VERIFICA(semaforo.contador == 0 && semaforo.fila_espera == 0);
+
+	/* liberada antes do tempo limite, a tarefa nao acorda de novo quando ele
+	   passa */
+	inicio = ObtemMarcaDeTempo();
+	Aguarda(0, 5);
+	TarefaEspera(2);
+	SemaforoLibera(&semaforo);
+	TarefaEspera(10);
+	VERIFICA(concluidas[0] == 3 && resultado[0] == SUCESSO && fim[0] - inicio == 2);
+	VERIFICA(TCB[id[0]].fila_espera == &partida[0].fila_espera);
+
+	/* TarefaContinua interrompe a espera, com e sem tempo limite */
+	inicio = ObtemMarcaDeTempo();
+	Aguarda(0, 10);
+	Aguarda(1, ESPERA_INFINITA);
+	TarefaEspera(3);
+	VERIFICA(TarefaContinua(id[0]) == SUCESSO && TarefaContinua(id[1]) == SUCESSO);
+	TarefaEspera(1);
+	VERIFICA(concluidas[0] == 4 && resultado[0] == ESPERA_INTERROMPIDA && fim[0] - inicio == 3);
+	VERIFICA(concluidas[1] == 2 && resultado[1] == ESPERA_INTERROMPIDA && fim[1] - inicio == 3);
+	VERIFICA(semaforo.fila_espera == 0 && semaforo.contador == 0);
+
+	/* e o tempo limite interrompido nao chega depois */
+	TarefaEspera(10);
+	VERIFICA(concluidas[0] == 4 && concluidas[1] == 2);
+
+	printf("semaforo com tempo: teste sem espera, tempos limite exatos, liberacao "
+		"antes do limite e espera interrompida ok\n");
+	exit(0);
+}
+
+int main(void)
+{
+	uint32_t i;
+
+	CriaTarefa(controle, "controle", pilha_controle, TAM_PILHA, CONTROLE);
+	for(i = 0; i < TRABALHADORAS; i++)
+	{
+		CriaTarefa(trabalhadora, "trabalhadora", pilhas_trabalhadoras[i], TAM_PILHA, i + 1);
+	}
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
@@ -0,0 +1,87 @@
+/*
+ * teste_tabela.c
+ *
+ * Tabela estatica de tarefas (cfg_TABELA_ESTATICA_TAREFAS), com o tempo
+ * virtual e a tabela de config/conf_tarefas.h: a periodica (prioridade 4) e a
+ * intensiva (prioridade 1), mais a ociosa acrescentada pelo sistema. Antes de
+ * IniciaMultitarefas os TCBs ja estao preenchidos, sem CriaTarefa; depois as
+ * tarefas executam na ordem das prioridades e a intensiva so perde a CPU
+ * quando a periodica acorda.
+ */
+
+#include <string.h>
+#include "rtos.h"
+#include "teste.h"
+
+#if !cfg_TABELA_ESTATICA_TAREFAS
+#error "o teste precisa de cfg_TABELA_ESTATICA_TAREFAS = 1"
+#endif
+
+#define ID_PERIODICA	1
+#define ID_INTENSIVA	2
+#define ID_OCIOSA		3
+
+#define PERIODO			5
+#define PERIODOS		20
+
+static volatile uint32_t execucoes_periodica, execucoes_intensiva;
+
+void tarefa_periodica(void)
+{
+	tick_t ultimo = ObtemMarcaDeTempo();
+
+	VERIFICA(tarefa_atual == ID_PERIODICA && execucoes_intensiva == 0);
+	for(;;)
+	{
+		execucoes_periodica++;
+		if(execucoes_periodica > PERIODOS)
+		{
+			/* a intensiva executou entre cada par de periodos */
+			VERIFICA(execucoes_intensiva == PERIODOS);
+			VERIFICA(ObtemMarcaDeTempo() == PERIODOS * PERIODO);
+			printf("tabela: %u tarefas criadas na compilacao, %u periodos de %u "
+				"marcas\n", (unsigned)NUMERO_DE_TAREFAS, (unsigned)PERIODOS, (unsigned)PERIODO);
+			exit(0);
+		}
+		TarefaEsperaAte(&ultimo, PERIODO);
+	}
+}
+
+/* calcula um periodo inteiro e espera a periodica acordar e dormir de novo */
+void tarefa_cpu_intensiva(void)
+{
+	uint32_t vista;
+
+	for(;;)
+	{
+		vista = execucoes_periodica;
+		execucoes_intensiva++;
+		PosixAvancaMarcas(PERIODO);
+		VERIFICA(execucoes_periodica == vista + 1);
+	}
+}
+
+int main(void)
+{
+	id_tarefa_t tarefa;
+
+	/* sem CriaTarefa: os TCBs vem da tabela */
+	VERIFICA(NUMERO_DE_TAREFAS == 3);
+	VERIFICA(strcmp(TCB[ID_PERIODICA].nome, "Tarefa Periodica") == 0);
+	VERIFICA(strcmp(TCB[ID_INTENSIVA].nome, "Tarefa Intensiva") == 0);
+	VERIFICA(strcmp(TCB[ID_OCIOSA].nome, "Tarefa ociosa") == 0);
+	VERIFICA(TCB[ID_PERIODICA].prioridade == 4 && TCB[ID_PERIODICA].prioridade_base == 4);
+	VERIFICA(TCB[ID_INTENSIVA].prioridade == 1 && TCB[ID_OCIOSA].prioridade == 0);
+	for(tarefa = 1; tarefa <= NUMERO_DE_TAREFAS; tarefa++)
+	{
+		VERIFICA(TCB[tarefa].estado == ESPERA && TCB[tarefa].stack_pointer != NULL);
+	}
+	/* as pilhas sao distintas */
+	VERIFICA(TCB[ID_PERIODICA].stack_pointer != TCB[ID_INTENSIVA].stack_pointer);
+	VERIFICA(TCB[ID_INTENSIVA].stack_pointer != TCB[ID_OCIOSA].stack_pointer);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
@@ -0,0 +1,151 @@
+/*
+ * teste_tarefas.c
+ *
+ * Criacao e termino de tarefas em tempo de execucao (TarefaCria e
+ * TarefaTermina), com o tempo virtual. Cria tarefas ate esgotar o conjunto de
+ * pilhas dinamicas; uma retorna da sua funcao (FimDeTarefa), outra termina a
+ * si mesma e a terceira eh terminada pela tarefa de controle. Depois que a
+ * ociosa libera as terminadas, novas tarefas devem reusar os mesmos TCBs e as
+ * mesmas pilhas. Por fim, a tarefa que retorna detendo um mutex fica suspensa.
+ */
+
+#include "rtos.h"
+#include "teste.h"
+
+#if cfg_PILHAS_DINAMICAS != 3
+#error "o teste precisa de cfg_PILHAS_DINAMICAS = 3"
+#endif
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+
+#define TRABALHO		2		/* as tarefas criadas so executam quando a de controle dorme */
+#define CONTROLE		3
+
+static uint32_t pilha_controle[TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static mutex_t mutex = {0, 0, 0, NULL};
+
+static volatile uint32_t retornos, fim_proprio, rodadas_fica;
+
+static void retorna(void)
+{
+	retornos++;
+}
+
+static void termina_a_si(void)
+{
+	fim_proprio++;
+	TarefaTermina(tarefa_atual);
+	VERIFICA(0);		/* nao retorna */
+}
+
+static void fica(void)
+{
+	for(;;)
+	{
+		rodadas_fica++;
+		TarefaEspera(1000);
+	}
+}
+
+static void retorna_com_mutex(void)
+{
+	MutexAguarda(&mutex);
+}
+
+static void controle(void)
+{
+	id_tarefa_t id[3], novo[3];
+	stackptr_t pilha[3];
+	uint32_t i, j, achou;
+
+	/* prioridade fora da faixa: nada eh alocado */
+	VERIFICA(TarefaCria(retorna, "invalida", PRIORIDADE_MAXIMA + 1) == 0);
+	VERIFICA(TarefaCria(retorna, "invalida", 255) == 0);
+
+	/* tres pilhas no conjunto: a quarta criacao falha */
+	id[0] = TarefaCria(retorna, "retorna", TRABALHO);
+	id[1] = TarefaCria(termina_a_si, "termina", TRABALHO);
+	id[2] = TarefaCria(fica, "fica", TRABALHO);
+	VERIFICA(id[0] != 0 && id[1] != 0 && id[2] != 0);
+	VERIFICA(id[0] != id[1] && id[1] != id[2] && id[0] != id[2]);
+	VERIFICA(TarefaCria(retorna, "sobra", TRABALHO) == 0);
+	for(i = 0; i < 3; i++)
+	{
+		pilha[i] = TCB[id[i]].pilha_dinamica;
+		VERIFICA(pilha[i] != NULL);
+	}
+
+	/* as tarefas executam enquanto a de controle dorme, e a ociosa libera as
+	   que terminaram */
+	TarefaEspera(2);
+	VERIFICA(retornos == 1 && fim_proprio == 1 && rodadas_fica == 1);
+	VERIFICA(TCB[id[0]].estado == LIVRE && TCB[id[0]].pilha_dinamica == NULL);
+	VERIFICA(TCB[id[1]].estado == LIVRE && TCB[id[1]].pilha_dinamica == NULL);
+	VERIFICA(TCB[id[2]].estado == ESPERA);
+
+	/* termino por outra tarefa, enquanto ela dorme; o identificador deixa de
+	   ser controlavel */
+	VERIFICA(TarefaTermina(id[2]) == SUCESSO);
+	VERIFICA(TCB[id[2]].estado == TERMINADA);
+	VERIFICA(TarefaTermina(id[2]) == NAO_PERMITIDO);
+	VERIFICA(TarefaTermina(id[0]) == NAO_PERMITIDO);
+	TarefaEspera(1);
+	VERIFICA(TCB[id[2]].estado == LIVRE);
+	VERIFICA(rodadas_fica == 1);
+
+	/* as novas tarefas reusam os TCBs e as pilhas liberados */
+	for(i = 0; i < 3; i++)
+	{
+		novo[i] = TarefaCria(retorna, "reuso", TRABALHO);
+		VERIFICA(novo[i] != 0);
+	}
+	VERIFICA(TarefaCria(retorna, "sobra", TRABALHO) == 0);
+	for(i = 0; i < 3; i++)
+	{
+		for(achou = 0, j = 0; j < 3; j++)
+		{
+			achou += (novo[i] == id[j]);
+		}
+		VERIFICA(achou == 1);
+		for(achou = 0, j = 0; j < 3; j++)
+		{
+			achou += (TCB[novo[i]].pilha_dinamica == pilha[j]);
+		}
+		VERIFICA(achou == 1);
+	}
+	TarefaEspera(2);
+	VERIFICA(retornos == 4);
+	for(i = 0; i < 3; i++)
+	{
+		VERIFICA(TCB[novo[i]].estado == LIVRE);
+	}
+
+	/* a tarefa que retorna detendo um mutex nao termina: fica suspensa, com o
+	   mutex e a pilha */
+	novo[0] = TarefaCria(retorna_com_mutex, "mutex", TRABALHO);
+	VERIFICA(novo[0] != 0);
+	TarefaEspera(2);
+	VERIFICA(TCB[novo[0]].estado == ESPERA && TCB[novo[0]].pilha_dinamica != NULL);
+	VERIFICA(TarefaTermina(novo[0]) == NAO_PERMITIDO);
+	VERIFICA(mutex.dono == novo[0]);
+	VERIFICA(MutexLibera(&mutex) == NAO_PERMITIDO);
+
+	printf("tarefas: %u criacoes, conjunto de %u pilhas esgotado, TCBs e pilhas "
+		"reusados, retorno com mutex suspenso\n", (unsigned)(retornos + fim_proprio + rodadas_fica + 1),
+		(unsigned)cfg_PILHAS_DINAMICAS);
+	exit(0);
+}
+
+int main(void)
+{
+	CriaTarefa(controle, "controle", pilha_controle, TAM_PILHA, CONTROLE);
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+
+	IniciaMultitarefas();
+
+	return 1;
+}
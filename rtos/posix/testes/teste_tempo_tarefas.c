@@ -0,0 +1,120 @@
+/*
+ * teste_tempo_tarefas.c
+ *
+ * Medicao do tempo de execucao das tarefas (cfg_MEDE_TEMPO_TAREFAS), com o
+ * tempo virtual, em que o contador de ciclos so anda de marca em marca. Duas
+ * tarefas periodicas calculam 3 e 2 marcas a cada 10 e a ociosa fica com o
+ * resto. Depois de PERIODOS periodos, a soma dos ciclos de todas as tarefas
+ * deve ser exatamente o tempo decorrido, cada tarefa deve ter a sua parte
+ * exata, e os contadores de trocas, preempcoes e despertares devem ser os das
+ * trocas conhecidas do cenario.
+ */
+
+#include "rtos.h"
+#include "teste.h"
+
+#if !cfg_MEDE_TEMPO_TAREFAS
+#error "o teste precisa de cfg_MEDE_TEMPO_TAREFAS = 1"
+#endif
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+
+#define PERIODO			10
+#define CALCULO_A		3
+#define CALCULO_B		2
+#define PERIODOS		1000
+
+#define ID_CONTROLE		1
+#define ID_A			2
+#define ID_B			3
+#define ID_OCIOSA		4
+
+static uint32_t pilha_controle[TAM_PILHA];
+static uint32_t pilha_a[TAM_PILHA];
+static uint32_t pilha_b[TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+static void Periodica(uint32_t calculo)
+{
+	tick_t ultimo = ObtemMarcaDeTempo();
+
+	for(;;)
+	{
+		PosixAvancaMarcas(calculo);
+		TarefaEsperaAte(&ultimo, PERIODO);
+	}
+}
+
+static void tarefa_a(void)
+{
+	Periodica(CALCULO_A);
+}
+
+static void tarefa_b(void)
+{
+	Periodica(CALCULO_B);
+}
+
+/* a de controle dorme durante todo o cenario e acorda na mesma marca que
+   comeca o periodo seguinte, antes das outras por ter maior prioridade */
+static void controle(void)
+{
+	uint32_t soma = 0;
+	id_tarefa_t tarefa;
+
+	VERIFICA(ObtemMarcaDeTempo() == 0);
+	TarefaEspera(PERIODOS * PERIODO);
+
+	/* ao voltar a executar, a de controle teve o seu tempo contado ate agora */
+	for(tarefa = 1; tarefa <= NUMERO_DE_TAREFAS; tarefa++)
+	{
+		soma += TCB[tarefa].ciclos_execucao;
+	}
+	VERIFICA(soma == ObtemMarcaDeTempo() * CICLOS_POR_MARCA());
+	VERIFICA(soma == LeContadorDeCiclos());
+
+	VERIFICA(TCB[ID_CONTROLE].ciclos_execucao == 0);
+	VERIFICA(TCB[ID_A].ciclos_execucao == PERIODOS * CALCULO_A * CICLOS_POR_MARCA());
+	VERIFICA(TCB[ID_B].ciclos_execucao == PERIODOS * CALCULO_B * CICLOS_POR_MARCA());
+	VERIFICA(TCB[ID_OCIOSA].ciclos_execucao ==
+		PERIODOS * (PERIODO - CALCULO_A - CALCULO_B) * CICLOS_POR_MARCA());
+
+	/* a cada periodo: ociosa -> A (preempcao da ociosa), A -> B, B -> ociosa;
+	   na ultima marca a de controle interrompe a ociosa no lugar de A */
+	VERIFICA(TCB[ID_CONTROLE].trocas == 2 && TCB[ID_CONTROLE].preempcoes == 0);
+	VERIFICA(TCB[ID_A].trocas == PERIODOS && TCB[ID_A].preempcoes == 0);
+	VERIFICA(TCB[ID_B].trocas == PERIODOS && TCB[ID_B].preempcoes == 0);
+	VERIFICA(TCB[ID_OCIOSA].trocas == PERIODOS && TCB[ID_OCIOSA].preempcoes == PERIODOS);
+
+	/* A ja acordou para o periodo seguinte; B conta os periodos a partir da
+	   marca CALCULO_A, em que executou pela primeira vez, e ainda nao */
+	VERIFICA(TCB[ID_CONTROLE].despertares == 1);
+	VERIFICA(TCB[ID_A].despertares == PERIODOS && TCB[ID_B].despertares == PERIODOS - 1);
+	VERIFICA(TCB[ID_OCIOSA].despertares == 0);
+
+	/* uso da CPU na ultima janela; as janelas nao se alinham com os saltos da
+	   ociosa, dai a folga de um ponto */
+	VERIFICA(TarefaUsoCPU(ID_A) >= 29 && TarefaUsoCPU(ID_A) <= 31);
+	VERIFICA(TarefaUsoCPU(ID_B) >= 19 && TarefaUsoCPU(ID_B) <= 21);
+	VERIFICA(TarefaUsoCPU(ID_OCIOSA) >= 49 && TarefaUsoCPU(ID_OCIOSA) <= 51);
+
+	printf("tempo das tarefas: %u marcas = %u ciclos, divididos %u/%u/%u (A/B/ociosa), "
+		"uso %u%%/%u%%/%u%%, %u trocas por tarefa\n", (unsigned)ObtemMarcaDeTempo(),
+		(unsigned)soma, (unsigned)TCB[ID_A].ciclos_execucao, (unsigned)TCB[ID_B].ciclos_execucao,
+		(unsigned)TCB[ID_OCIOSA].ciclos_execucao, (unsigned)TarefaUsoCPU(ID_A),
+		(unsigned)TarefaUsoCPU(ID_B), (unsigned)TarefaUsoCPU(ID_OCIOSA), (unsigned)PERIODOS);
+	exit(0);
+}
+
+int main(void)
+{
+	CriaTarefa(controle, "controle", pilha_controle, TAM_PILHA, 3);
+	CriaTarefa(tarefa_a, "a", pilha_a, TAM_PILHA, 2);
+	CriaTarefa(tarefa_b, "b", pilha_b, TAM_PILHA, 1);
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
@@ -0,0 +1,165 @@
+/*
+ * teste_traco.c
+ *
+ * Traco do sistema (cfg_TRACO), com o tempo virtual. Primeiro um cenario
+ * curto, que cabe no buffer, cujos registros sao comparados um a um com a
+ * sequencia esperada (criacao, trocas de contexto, bloqueios, marcas de tempo
+ * e marcas do usuario). Depois a tarefa de trabalho escreve mais registros
+ * que o buffer comporta: o indice continua contando, os mais antigos sao
+ * sobrescritos e o mais antigo que resta fica na posicao do proximo. O buffer
+ * eh gravado em ARQUIVO_TRACO, que o make test decodifica com tools/traco.py
+ * e compara com testes/traco.txt.
+ */
+
+#include <string.h>
+#include "rtos.h"
+#include "teste.h"
+
+#if cfg_TRACO != 64
+#error "o teste precisa de cfg_TRACO = 64"
+#endif
+
+#ifndef ARQUIVO_TRACO
+#define ARQUIVO_TRACO	"obj/traco.bin"
+#endif
+
+#define TAM_PILHA		(TAM_MINIMO_PILHA + 24)
+
+#define ID_CONTROLE		1
+#define ID_TRABALHO		2
+#define ID_OCIOSA		3
+
+#define MARCAS_USUARIO	100			/* mais que cfg_TRACO */
+
+static uint32_t pilha_controle[TAM_PILHA];
+static uint32_t pilha_trabalho[TAM_PILHA];
+static uint32_t pilha_ociosa[TAM_PILHA];
+
+typedef struct
+{
+	uint8_t		evento;
+	uint8_t		tarefa;
+	uint16_t	dado;
+	tick_t		marca;		/* instante, em marcas de tempo */
+} esperado_t;
+
+/* cenario curto: criacao, a de controle dorme 2 marcas, a de trabalho calcula
+   1 marca e dorme 2, a ociosa dorme ate a de controle acordar */
+static const esperado_t cenario[] =
+{
+	{TRACO_PRONTA,		ID_CONTROLE,	2,				0},
+	{TRACO_PRONTA,		ID_TRABALHO,	1,				0},
+	{TRACO_PRONTA,		ID_OCIOSA,		0,				0},
+	{TRACO_TROCA,		ID_CONTROLE,	0,				0},
+	{TRACO_USUARIO,		ID_CONTROLE,	1,				0},
+	{TRACO_BLOQUEIA,	ID_CONTROLE,	2,				0},
+	{TRACO_TROCA,		ID_TRABALHO,	ID_CONTROLE,	0},
+	{TRACO_USUARIO,		ID_TRABALHO,	2,				0},
+	{TRACO_MARCA,		ID_TRABALHO,	1,				1},
+	{TRACO_BLOQUEIA,	ID_TRABALHO,	1,				1},
+	{TRACO_TROCA,		ID_OCIOSA,		ID_TRABALHO,	1},
+	{TRACO_PRONTA,		ID_CONTROLE,	2,				2},
+	{TRACO_TROCA,		ID_CONTROLE,	ID_OCIOSA,		2},
+	{TRACO_USUARIO,		ID_CONTROLE,	3,				2},
+};
+
+#define REGISTROS_CENARIO	(sizeof(cenario) / sizeof(cenario[0]))
+
+/* depois da volta: os 4 ultimos registros, depois das marcas do usuario */
+static const esperado_t fim_do_traco[] =
+{
+	{TRACO_BLOQUEIA,	ID_TRABALHO,	1,				3},
+	{TRACO_TROCA,		ID_OCIOSA,		ID_TRABALHO,	3},
+	{TRACO_PRONTA,		ID_CONTROLE,	2,				5},
+	{TRACO_TROCA,		ID_CONTROLE,	ID_OCIOSA,		5},
+};
+
+static void trabalho(void)
+{
+	uint16_t i;
+
+	TracoMarca(2);
+	PosixAvancaMarcas(1);
+	TarefaEspera(2);
+
+	/* acorda na marca 3 e da a volta no buffer */
+	for(i = 0; i < MARCAS_USUARIO; i++)
+	{
+		TracoMarca((uint16_t)(1000 + i));
+	}
+	TarefaEspera(1000);
+}
+
+static void controle(void)
+{
+	const registro_traco_t *r;
+	uint32_t i, indice;
+	FILE *arquivo;
+
+	TracoMarca(1);
+	TarefaEspera(2);
+	TracoMarca(3);
+
+	/* o cenario curto, registro a registro */
+	VERIFICA(traco.identificador == TRACO_IDENTIFICADOR && traco.numero_registros == cfg_TRACO);
+	VERIFICA(traco.indice == REGISTROS_CENARIO);
+	for(i = 0; i < REGISTROS_CENARIO; i++)
+	{
+		r = &traco.registros[i];
+		if(r->evento != cenario[i].evento || r->tarefa != cenario[i].tarefa ||
+			r->dado != cenario[i].dado || r->tempo != cenario[i].marca * CICLOS_POR_MARCA())
+		{
+			fprintf(stderr, "registro %u: evento %u tarefa %u dado %u tempo %u\n", (unsigned)i,
+				(unsigned)r->evento, (unsigned)r->tarefa, (unsigned)r->dado, (unsigned)r->tempo);
+		}
+		VERIFICA(r->evento == cenario[i].evento && r->tarefa == cenario[i].tarefa);
+		VERIFICA(r->dado == cenario[i].dado);
+		VERIFICA(r->tempo == cenario[i].marca * CICLOS_POR_MARCA());
+	}
+	VERIFICA(strncmp(traco.nomes[ID_TRABALHO], "trabalho", TRACO_TAM_NOME) == 0);
+
+	/* a de trabalho escreve mais marcas que o buffer comporta: o indice conta
+	   todos os registros e, a partir da posicao do proximo, estao os mais
+	   recentes em ordem: as ultimas marcas do usuario e as trocas ate a de
+	   controle voltar */
+	TarefaEspera(3);
+	indice = traco.indice;
+	/* antes das marcas: a de controle bloqueia e a ociosa entra (marca 2), a
+	   de trabalho fica pronta e entra (marca 3) */
+	VERIFICA(indice == REGISTROS_CENARIO + 4 + MARCAS_USUARIO + 4);
+	for(i = 0; i < cfg_TRACO - 4; i++)
+	{
+		r = &traco.registros[(indice + i) & (cfg_TRACO - 1)];
+		VERIFICA(r->evento == TRACO_USUARIO && r->tarefa == ID_TRABALHO);
+		VERIFICA(r->dado == 1000 + MARCAS_USUARIO - (cfg_TRACO - 4) + i);
+		VERIFICA(r->tempo == 3 * CICLOS_POR_MARCA());
+	}
+	for(i = 0; i < 4; i++)
+	{
+		r = &traco.registros[(indice - 4 + i) & (cfg_TRACO - 1)];
+		VERIFICA(r->evento == fim_do_traco[i].evento && r->tarefa == fim_do_traco[i].tarefa);
+		VERIFICA(r->dado == fim_do_traco[i].dado);
+		VERIFICA(r->tempo == fim_do_traco[i].marca * CICLOS_POR_MARCA());
+	}
+
+	arquivo = fopen(ARQUIVO_TRACO, "wb");
+	VERIFICA(arquivo != NULL);
+	VERIFICA(fwrite(&traco, sizeof(traco), 1, arquivo) == 1);
+	fclose(arquivo);
+
+	printf("traco: %u registros no cenario, %u escritos no total em %u posicoes\n",
+		(unsigned)REGISTROS_CENARIO, (unsigned)indice, (unsigned)cfg_TRACO);
+	exit(0);
+}
+
+int main(void)
+{
+	CriaTarefa(controle, "controle", pilha_controle, TAM_PILHA, 2);
+	CriaTarefa(trabalho, "trabalho", pilha_trabalho, TAM_PILHA, 1);
+	CriaTarefa(tarefa_ociosa, "ociosa", pilha_ociosa, TAM_PILHA, 0);
+
+	ConfiguraMarcaTempo();
+	IniciaMultitarefas();
+
+	return 1;
+}
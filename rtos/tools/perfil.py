@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+perfil.py
+
+Converte as amostras do perfil estatistico do sistema multitarefas 
+(cfg_PERFIL > 0 em rtos.h) em um perfil plano por funcao, no total e para
+cada tarefa. Os enderecos sao associados as funcoes com o nm do ELF do
+firmware.
+
+O arquivo de amostras eh a copia binaria da variavel perfil, por exemplo no gdb:
+
+    dump binary value perfil.bin perfil
+
+Uso:
+
+    perfil.py perfil.bin firmware.elf
+    perfil.py perfil.bin firmware.elf --nm arm-none-eabi-nm --linhas 10
+"""
+
+import argparse
+import bisect
+import collections
+import struct
+import subprocess
+import sys
+
+PERFIL_IDENTIFICADOR = 0x50455246
+PERFIL_TAM_NOME = 8
+
+CABECALHO = struct.Struct('<IIIHH')
+
+
+def le_perfil(dados):
+    """retorna (frequencia, nomes, lista de (pc, tarefa))"""
+    if len(dados) < CABECALHO.size:
+        raise ValueError('arquivo menor que o cabecalho do perfil')
+    identificador, frequencia, indice, numero_amostras, numero_nomes = CABECALHO.unpack_from(dados, 0)
+    if identificador != PERFIL_IDENTIFICADOR:
+        raise ValueError('identificador do perfil invalido: 0x%08x' % identificador)
+
+    posicao = CABECALHO.size
+    nomes = []
+    for i in range(numero_nomes):
+        nome = dados[posicao:posicao + PERFIL_TAM_NOME].split(b'\0')[0]
+        nomes.append(nome.decode('ascii', 'replace') or 'tarefa %d' % i)
+        posicao += PERFIL_TAM_NOME
+
+    if len(dados) < posicao + numero_amostras * 5:
+        raise ValueError('arquivo menor que o buffer do perfil')
+    pcs = struct.unpack_from('<%dI' % numero_amostras, dados, posicao)
+    tarefas = struct.unpack_from('<%dB' % numero_amostras, dados, posicao + 4 * numero_amostras)
+
+    # enquanto o buffer nao deu a volta, so as primeiras posicoes sao validas
+    validas = min(indice, numero_amostras)
+    return frequencia, nomes, list(zip(pcs[:validas], tarefas[:validas]))
+
+
+def le_simbolos(elf, nm):
+    """enderecos iniciais e nomes das funcoes do ELF, em ordem de endereco"""
+    saida = subprocess.run([nm, '-n', '--defined-only', elf], check=True,
+                           stdout=subprocess.PIPE, universal_newlines=True).stdout
+    enderecos = []
+    nomes = []
+    for linha in saida.splitlines():
+        campos = linha.split()
+        if len(campos) != 3 or campos[1] not in 'tTwW':
+            continue
+        # o bit 0 dos enderecos das funcoes Thumb indica o modo, nao o endereco
+        endereco = int(campos[0], 16) & ~1
+        if enderecos and enderecos[-1] == endereco:
+            continue
+        enderecos.append(endereco)
+        nomes.append(campos[2])
+    return enderecos, nomes
+
+
+def funcao(enderecos, nomes, pc):
+    i = bisect.bisect_right(enderecos, pc) - 1
+    return nomes[i] if i >= 0 else '0x%08x' % pc
+
+
+def imprime(titulo, contagem, total, linhas):
+    print(titulo)
+    print('  %6s %9s  %s' % ('%', 'amostras', 'funcao'))
+    for nome, n in contagem.most_common(linhas):
+        print('  %6.2f %9d  %s' % (100.0 * n / total, n, nome))
+    print('')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Perfil por funcao e por tarefa')
+    parser.add_argument('arquivo', help='copia binaria da variavel perfil')
+    parser.add_argument('elf', help='ELF do firmware que gerou as amostras')
+    parser.add_argument('--nm', default='arm-none-eabi-nm', help='programa nm (padrao: arm-none-eabi-nm)')
+    parser.add_argument('--linhas', type=int, default=20, help='funcoes mostradas em cada tabela')
+    args = parser.parse_args()
+
+    with open(args.arquivo, 'rb') as f:
+        frequencia, nomes_tarefas, amostras = le_perfil(f.read())
+    if not amostras:
+        sys.exit('nenhuma amostra no perfil')
+    enderecos, nomes = le_simbolos(args.elf, args.nm)
+
+    total = collections.Counter()
+    por_tarefa = collections.defaultdict(collections.Counter)
+    for pc, tarefa in amostras:
+        nome = funcao(enderecos, nomes, pc)
+        total[nome] += 1
+        por_tarefa[tarefa][nome] += 1
+
+    print('%d amostras, %d amostras/s (%.2f s)\n' % (len(amostras), frequencia, float(len(amostras)) / frequencia))
+    imprime('todas as tarefas:', total, len(amostras), args.linhas)
+    for tarefa in sorted(por_tarefa, key=lambda t: -sum(por_tarefa[t].values())):
+        n = sum(por_tarefa[tarefa].values())
+        nome = nomes_tarefas[tarefa] if tarefa < len(nomes_tarefas) else 'tarefa %d' % tarefa
+        imprime('tarefa %d %s: %.2f%% das amostras' % (tarefa, nome, 100.0 * n / len(amostras)),
+                por_tarefa[tarefa], n, args.linhas)
+
+
+if __name__ == '__main__':
+    main()
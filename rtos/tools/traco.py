@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+traco.py
+
+Decodifica o traco do sistema multitarefas (cfg_TRACO > 0 em rtos.h) e gera
+uma linha do tempo no formato JSON do Chrome (chrome://tracing ou
+https://ui.perfetto.dev), com uma linha por tarefa.
+
+O arquivo de entrada eh a copia binaria da variavel traco, por exemplo no gdb:
+
+    dump binary value traco.bin traco
+
+Uso:
+
+    traco.py traco.bin -o traco.json      linha do tempo
+    traco.py traco.bin --texto            lista dos eventos
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+TRACO_IDENTIFICADOR = 0x54524143
+TRACO_TAM_NOME = 8
+
+CABECALHO = struct.Struct('<IIIIHH')
+REGISTRO = struct.Struct('<IHBB')
+
+# deve seguir evento_traco_t em rtos.h
+TROCA, MARCA, PRONTA, BLOQUEIA, SEMAFORO_AGUARDA, SEMAFORO_LIBERA, USUARIO = range(1, 8)
+
+NOMES_EVENTOS = {
+    TROCA: 'troca',
+    MARCA: 'marca',
+    PRONTA: 'pronta',
+    BLOQUEIA: 'bloqueia',
+    SEMAFORO_AGUARDA: 'semaforo aguarda',
+    SEMAFORO_LIBERA: 'semaforo libera',
+    USUARIO: 'usuario',
+}
+
+
+def le_traco(dados):
+    """retorna (frequencia, ciclos_por_evento, nomes, registros em ordem)"""
+    if len(dados) < CABECALHO.size:
+        raise ValueError('arquivo menor que o cabecalho do traco')
+    (identificador, frequencia, indice, ciclos_por_evento,
+     numero_registros, numero_nomes) = CABECALHO.unpack_from(dados, 0)
+    if identificador != TRACO_IDENTIFICADOR:
+        raise ValueError('identificador do traco invalido: 0x%08x' % identificador)
+
+    posicao = CABECALHO.size
+    nomes = []
+    for i in range(numero_nomes):
+        nome = dados[posicao:posicao + TRACO_TAM_NOME].split(b'\0')[0]
+        nomes.append(nome.decode('ascii', 'replace') or 'tarefa %d' % i)
+        posicao += TRACO_TAM_NOME
+
+    if len(dados) < posicao + numero_registros * REGISTRO.size:
+        raise ValueError('arquivo menor que o buffer do traco')
+    registros = [REGISTRO.unpack_from(dados, posicao + i * REGISTRO.size)
+                 for i in range(numero_registros)]
+
+    # buffer circular: se deu a volta, o mais antigo esta na posicao do proximo
+    if indice <= numero_registros:
+        registros = registros[:indice]
+    else:
+        inicio = indice % numero_registros
+        registros = registros[inicio:] + registros[:inicio]
+
+    return frequencia, ciclos_por_evento, nomes, registros
+
+
+def tempos_continuos(registros):
+    """desfaz a volta a zero do contador de ciclos de 32 bits; supoe menos de
+    2^32 ciclos entre dois eventos seguidos"""
+    tempo = 0
+    anterior = None
+    for tempo_32, dado, evento, tarefa in registros:
+        if anterior is not None:
+            tempo += (tempo_32 - anterior) & 0xFFFFFFFF
+        anterior = tempo_32
+        yield tempo, evento, tarefa, dado
+
+
+def nome_tarefa(nomes, tarefa):
+    return nomes[tarefa] if tarefa < len(nomes) else 'tarefa %d' % tarefa
+
+
+def descreve(evento, dado, nomes):
+    if evento == TROCA:
+        return 'sai %s' % nome_tarefa(nomes, dado)
+    if evento in (SEMAFORO_AGUARDA, SEMAFORO_LIBERA):
+        return 'semaforo 0x%04x' % dado
+    if evento in (PRONTA, BLOQUEIA):
+        return 'prioridade %d' % dado
+    return '%d' % dado
+
+
+def linha_do_tempo(frequencia, nomes, registros, com_marcas):
+    """eventos do Chrome trace: um intervalo por execucao de tarefa e eventos
+    instantaneos para os demais registros"""
+    us_por_ciclo = 1e6 / frequencia
+    eventos = []
+    usadas = set()
+    executando = None
+    inicio = 0
+
+    for tempo, evento, tarefa, dado in tempos_continuos(registros):
+        ts = tempo * us_por_ciclo
+        if evento == TROCA:
+            if executando is not None:
+                eventos.append({'name': nome_tarefa(nomes, executando), 'ph': 'X',
+                                'pid': 1, 'tid': executando,
+                                'ts': inicio, 'dur': ts - inicio})
+            executando = tarefa
+            inicio = ts
+            usadas.add(tarefa)
+            continue
+        if evento == MARCA and not com_marcas:
+            continue
+        eventos.append({'name': NOMES_EVENTOS.get(evento, 'evento %d' % evento),
+                        'ph': 'i', 's': 't', 'pid': 1, 'tid': tarefa, 'ts': ts,
+                        'args': {'dado': descreve(evento, dado, nomes)}})
+        usadas.add(tarefa)
+
+    for tarefa in sorted(usadas):
+        eventos.append({'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': tarefa,
+                        'args': {'name': '%d %s' % (tarefa, nome_tarefa(nomes, tarefa))}})
+    return {'traceEvents': eventos, 'displayTimeUnit': 'ns'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decodifica o traco do sistema multitarefas')
+    parser.add_argument('arquivo', help='copia binaria da variavel traco')
+    parser.add_argument('-o', '--saida', help='arquivo JSON de saida (padrao: saida padrao)')
+    parser.add_argument('--texto', action='store_true', help='lista os eventos em texto')
+    parser.add_argument('--sem-marcas', action='store_true', help='omite as marcas de tempo')
+    args = parser.parse_args()
+
+    with open(args.arquivo, 'rb') as f:
+        frequencia, ciclos_por_evento, nomes, registros = le_traco(f.read())
+
+    sys.stderr.write('%d registros, custo medido de %d ciclos por registro\n'
+                     % (len(registros), ciclos_por_evento))
+
+    saida = open(args.saida, 'w') if args.saida else sys.stdout
+    if args.texto:
+        for tempo, evento, tarefa, dado in tempos_continuos(registros):
+            if evento == MARCA and args.sem_marcas:
+                continue
+            saida.write('%12.3f us  %-16s %-10s %s\n' % (
+                tempo * 1e6 / frequencia, NOMES_EVENTOS.get(evento, '?'),
+                nome_tarefa(nomes, tarefa), descreve(evento, dado, nomes)))
+    else:
+        json.dump(linha_do_tempo(frequencia, nomes, registros, not args.sem_marcas), saida)
+        saida.write('\n')
+    if saida is not sys.stdout:
+        saida.close()
+
+
+if __name__ == '__main__':
+    main()